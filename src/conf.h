@@ -35,6 +35,24 @@
  */
 #define OW_BIT				5
 
+/**
+ * @def OW_MULTI_BUS
+ *
+ * Describes buses with OwBus objects instead of the constants
+ * above. OwContext carries its bus and one library instance
+ * serves any number of buses. Without it the single bus above
+ * is accessed with constant addresses.
+ */
+//#define OW_MULTI_BUS
+
+/**
+ * @def OW_PARALLEL
+ *
+ * Enables the parallel slot engine for several buses on
+ * the same port.
+ */
+//#define OW_PARALLEL
+
 /**
  * @def OW_MAX_ROMS
  *
@@ -42,6 +60,228 @@
  */
 #define OW_MAX_ROMS			5
 
+/**
+ * @def OW_CONTEXT_BUFFER
+ *
+ * Stores roms of a context in a buffer given to OwContextInit()
+ * instead of reserving OW_MAX_ROMS entries in every context.
+ * OW_MAX_ROMS still limits the conversion scheduler.
+ */
+//#define OW_CONTEXT_BUFFER
+
+/**
+ * @def OW_ROM_INDEX
+ *
+ * Keeps the slots of each context sorted by rom in search order
+ * so that OwRomIndex() and OwRomFind() use binary search. Costs
+ * one byte per rom.
+ */
+//#define OW_ROM_INDEX
+
+/**
+ * @def OW_SKIP_SINGLE_ROM
+ *
+ * Addresses the device of a context holding a single rom with
+ * Skip rom instead of Match rom. Only for buses with exactly
+ * one device.
+ */
+//#define OW_SKIP_SINGLE_ROM
+
 //#define OW_INTERNAL_PULLUP
 //#define OW_BLOCK_INTERRUPTS
 //#define OW_BLOCK_INTERRUPTS_BITLEVEL
+
+/**
+ * @def OW_BLOCK_INTERRUPTS_SAMPLE
+ *
+ * Masks interrupts only from the falling edge of a slot to its
+ * sample point or the release of a one bit. Presence pulse is
+ * polled with interrupts enabled. Excludes the other blocking
+ * modes.
+ */
+//#define OW_BLOCK_INTERRUPTS_SAMPLE
+
+/**
+ * @def OW_OVERDRIVE
+ *
+ * Enables overdrive speed support. Speed is selected at
+ * runtime with OwSetSpeed() or per transaction.
+ */
+//#define OW_OVERDRIVE
+
+/**
+ * @def OW_TXN_RETRIES
+ *
+ * Attempts repeated for a failing transaction. Retry n waits
+ * OW_TXN_BACKOFF_US << (n - 1) us before its reset, with
+ * interrupts enabled. Timer-driven engine retries immediately.
+ */
+#define OW_TXN_RETRIES			0
+#define OW_TXN_BACKOFF_US		100
+
+/**
+ * @def OW_RESET_EARLY
+ *
+ * Ends reset once the presence pulse is over instead of waiting
+ * the whole reset high time. Recovery after the presence pulse is
+ * as long as the presence sample delay.
+ */
+//#define OW_RESET_EARLY
+
+/**
+ * @def OW_EDGE
+ *
+ * Captures low pulses driven by slaves while the bus is idle with
+ * a pin change interrupt, e.g. presence pulse of a device attached
+ * to the bus. Timestamped with OW_STATS_CLOCK(). The bus pin has
+ * to be OW_BIT of the pin change group given below.
+ */
+//#define OW_EDGE
+#define OW_EDGE_PCMSK			PCMSK1
+#define OW_EDGE_PCIE			PCIE1
+#define OW_EDGE_PCIF			PCIF1
+#define OW_EDGE_vect			PCINT1_vect
+
+/**
+ * @def OW_CALIBRATION
+ *
+ * Times standard speed slots from per-bus values measured by
+ * OwCalibrate() instead of the fixed delays. Not available with
+ * OW_ASYNC.
+ */
+//#define OW_CALIBRATION
+
+/**
+ * @def OW_ASYNC
+ *
+ * Runs reset and bit slots from a Timer1 compare match interrupt
+ * instead of busy-waiting. Blocking functions keep working as
+ * wrappers which wait for the engine to finish.
+ */
+//#define OW_ASYNC
+
+/**
+ * @def OW_ASYNC_PRESCALER
+ *
+ * Timer1 prescaler used by the timer-driven engine. Valid values
+ * are 1, 8 and 64. The longest interval (reset pulse) has to fit
+ * in 16 bits.
+ */
+#define OW_ASYNC_PRESCALER		8
+
+/**
+ * @def OW_SLEEP
+ *
+ * Sleeps in idle mode while the timer-driven engine waits and
+ * adds OwSleep() and OwConvertSleep(), which sleep in power-down
+ * with the watchdog interrupt as wake source.
+ */
+//#define OW_SLEEP
+
+/**
+ * @def OW_UART
+ *
+ * Drives the bus with USART instead of OW_PORT. TX and RX are
+ * connected to the bus through an open-drain driver. Reset is
+ * written at 9600 baud and each bit slot is one character at
+ * 115200 baud. Implies OW_ASYNC.
+ */
+//#define OW_UART
+
+/**
+ * @def OW_UART_UCSRA
+ *
+ * USART registers used by the UART backend. Bit names of
+ * USART0 are used for the control registers.
+ */
+#define OW_UART_UCSRA			UCSR0A
+#define OW_UART_UCSRB			UCSR0B
+#define OW_UART_UCSRC			UCSR0C
+#define OW_UART_UBRR			UBRR0
+#define OW_UART_UDR			UDR0
+
+/**
+ * @def OW_UART_RX_vect
+ *
+ * RX complete interrupt of the USART. USART0_RX_vect on
+ * devices with several USARTs.
+ */
+#define OW_UART_RX_vect			USART_RX_vect
+
+/**
+ * @def OW_CRC_TABLE
+ *
+ * Computes crcs with 256-entry tables in program memory
+ * (768 bytes). OW_CRC_NIBBLE uses 16-entry tables instead
+ * (96 bytes). Without either crcs are computed bitwise.
+ */
+//#define OW_CRC_TABLE
+//#define OW_CRC_NIBBLE
+
+/**
+ * @def OW_CRC_STREAM
+ *
+ * Updates streaming crcs with every byte read or written
+ * by the blocking functions.
+ */
+//#define OW_CRC_STREAM
+
+/**
+ * @def OW_STRONG_PULLUP
+ *
+ * Enables the strong pull-up for parasite powered devices.
+ * Bus is released from a Timer2 compare match interrupt.
+ */
+//#define OW_STRONG_PULLUP
+
+/**
+ * @def OW_POWER_PRESCALER
+ *
+ * Timer2 prescaler of the strong pull-up. Valid values are 64,
+ * 128 and 256. One millisecond has to fit in 8 bits.
+ */
+#define OW_POWER_PRESCALER		64
+
+/**
+ * @def OW_ROM_CACHE
+ *
+ * Enables the rom table cache in EEPROM. The cache takes
+ * OW_MAX_ROMS * 8 + 4 bytes starting at OW_CACHE_ADDRESS.
+ */
+//#define OW_ROM_CACHE
+#define OW_CACHE_ADDRESS		0x0000
+
+/**
+ * @def OW_STATS
+ *
+ * Enables instrumentation counters. OW_TRACE enables the ring
+ * buffer of recent bus events. Both are timestamped with
+ * OW_STATS_CLOCK(), a 16-bit free-running timer set up by the
+ * application.
+ */
+//#define OW_STATS
+//#define OW_TRACE
+#define OW_STATS_CLOCK()		TCNT1
+#define OW_TRACE_SIZE			16
+
+/**
+ * @def OW_BENCH
+ *
+ * Enables the on-target benchmark, which takes Timer1 with
+ * OW_BENCH_PRESCALER. The interrupt probe fires every
+ * OW_BENCH_PERIOD ticks and each operation is measured
+ * OW_BENCH_REPEAT times.
+ */
+//#define OW_BENCH
+#define OW_BENCH_PRESCALER		8
+#define OW_BENCH_PERIOD			97
+#define OW_BENCH_REPEAT			8
+
+/**
+ * @def OW_SIM
+ *
+ * Builds the library for a host with the simulated bus of
+ * onewire_sim.c instead of the pin. Single bus and blocking
+ * functions only.
+ */
+//#define OW_SIM
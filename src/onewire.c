@@ -7,56 +7,160 @@
  *
  * @section intro_sec Introduction
  * <p>This is an universal 1-Wire master library for AVR MCUs based on unfinished ds1820 library by Ilari Nummila, Olli-Pekka Korpela and Jukka Pitkänen.</p>
- * <p>The rom search function supports up to 31 conflicts which results in guaranteed support for 32 devices. The theoretical maximum amount of devices is 2^32 but the actual amount is up to luck. This will not cause any problems due to signal integrity restrictions. OW_MAX_ROMS defines the maximum amount of devices. Memory is always reserved for the maximum amount of devices.</p>
+ * <p>The rom search function implements the search algorithm of Maxim application note 187 and finds each device with a single 64-bit pass. The number of devices on the bus is not limited by the search. OW_MAX_ROMS defines the maximum amount of devices stored into context. Memory is reserved for the maximum amount of devices unless OW_CONTEXT_BUFFER is defined, in which case OwContextInit() gives each context a buffer of OW_CONTEXT_BUFFER_SIZE() bytes with its own capacity. OwPackedSearch() stores devices of one family into an OwPackedTable as 6-byte serials, the family code is kept once and crc is recomputed by OwPackedRom(). OwSearchFirst() and OwSearchNext() enumerate devices one at a time without storing them. OwSearchFamily() presets the search to a family code and stores only devices of that family. OwAlarmSearch() runs the same search with Alarm search command and reports only devices with alarm flag set. Status of the last search pass is left in the search state, a search ending early because of a bus fault is told apart from the end of the devices.</p>
+ * <p>Defining OW_ROM_CACHE stores the rom table into EEPROM with OwCacheStore(). OwCacheStartup() loads the cached roms and checks them without a search: a single rom with OwReadRom(), DS18B20 sensors with a crc-checked scratchpad read and other families with a search pass of OwVerify(). A full search is run only when the cache is invalid or a device is missing. Free slots left by a rescan are not cached.</p>
+ * <p>OwRescanStep() runs one search pass of a rescan and can be called from the main loop, OwRescan() runs a whole rescan. A rescan costs one search pass per present device like OwSearchRom(), since an unknown device can hide behind any known rom prefix, but its result is applied as changes to the stored roms. Devices attached since the last scan are added to free slots and devices not found are removed, each change is reported to a callback. Slot of a present device never changes, removed slots are zeroed and reused.</p>
+ * <p>OwRomIndex() finds the slot of a rom and OwRomFind() the slot of a family code and serial prefix, so devices can be kept by slot and looked up once after a scan instead of before every command. Roms from a full search are stored in search order but a rescan fills free slots as devices appear, so with OW_ROM_INDEX a separate list of slots sorted by rom is kept in the context and both lookups use binary search. The list is rebuilt when roms of the context change.</p>
+ * <p>OwReadRom() identifies the only device of a bus with Read rom instead of a search. With OW_SKIP_SINGLE_ROM a context known to hold the only device of the bus, from OwReadRom() or a full search finding a single rom, addresses it with Skip rom, which saves 64 bit slots per command.</p>
  * @section Connections
  * <p>1-Wire bus can be connected with external pull-up resistor to Vcc or using internal pull-up. Internal pull-ups cannot power devices operating on parasitic power or drive a bus with multiple externally powered devices. Internal pull-ups are selected by defining constant OW_INTERNAL_PULLUP. I/O pin is selected with OW_PORT, OW_PIN, OW_DIRECTION and OW_BIT.</p>
  * @section Usage
  * <p>OW_MAX_ROMS and F_CPU in header file have to be set up according to application. OwInit() is called to initialize the bus. If multiple devices are connected OwSearchRom() function is called to search device roms. This allows addressing devices with rom index.</p>
  * <p>From this point writing commands to devices with OwWriteByteTo() and reading responses with OwReadByte() is fairly straight forward procedure.</p>
+ * <p>Repeating sequences of reset, rom selection, command and reads can be described with OwTransaction descriptors. OwTransact() executes an array of them back-to-back and disables interrupts only once for the whole array when OW_BLOCK_INTERRUPTS is defined. Transactions without presence pulse are skipped after the reset. Status of each transaction is stored into it, OW_TXN_CRC8 checks the crc of the read bytes. A failing transaction is repeated up to OW_TXN_RETRIES times with doubling backoff while the rest of the queue is not repeated.</p>
+ * <p>OwReadBlock() and OwWriteBlock() move a buffer within a single interrupt blocking window. OwReadBlockUntil() and OwWriteBlockUntil() call a callback after each byte which can stop the transfer early, e.g. once the bytes actually used have arrived. OwReadStream() gives each byte to the callback without storing it, for reads longer than any buffer.</p>
+ * <p>OwCommand() resets the bus, selects a device and writes a function command in one call.</p>
+ * <p>OwReadScratchpad() reads only the first bytes of a scratchpad and ends the transfer with a reset. Reading through to the crc byte is optional when integrity matters.</p>
+ * @section dev_sec Devices
+ * <p>Device modules decode responses byte by byte as they arrive, without copying whole scratchpads or floating point math. OwDs18b20Read() gives the temperature in 1/16 C, OW_DS18B20_CENTI() converts it to 1/100 C and OwDs18b20Parasite() tells parasite powered sensors. Device functions return OW_OK or an OW_ERR_ code, except OwDs2431Read() which returns the number of bytes read. OwDs2413Read() and OwDs2413Write() access the two PIO channels of DS2413 with the complement and confirmation checks of the device. OwDs2431Read() reads DS2431 memory with Read memory and streams each byte to a callback as it arrives without a buffer, so a read can end as soon as the wanted data has been seen, and OwDs2431WriteRow() writes an 8-byte row through the scratchpad with crc16 and copy verification.</p>
+ * @section convert_sec Conversion scheduler
+ * <p>OwConvertStart() starts every sensor of the bus with a single Skip rom and Convert T. OwConvertUpdate() is called from the main loop with a millisecond tick of the application and returns OW_CONVERT_READY once the conversion time of a sensor has passed, or earlier when read slots report done status with OW_CONVERT_POLL. OwConvertRead() then reads the ready sensors of the context with Match rom. A sweep over N sensors takes a single conversion time instead of N.</p>
+ * <p>OwSetResolution() writes the resolution of a sensor with Write scratchpad and stores it into the context. Conversion time is derived per sensor: 94, 188, 375 or 750 ms for 9 to 12 bits. Sensors with lower resolution are read as soon as their group is ready, the rest of the sweep waits only for the slowest resolution present.</p>
+ * <p>Defining OW_STRONG_PULLUP enables OwWriteBytePower() for parasite powered devices. The bus pin is driven high as an output right after the last bit of Convert T or Copy scratchpad and released from a Timer2 interrupt after given time, so the application keeps running during the conversion. OwPowerActive() tells when the bus can be used again. OW_CONVERT_POWER makes the conversion scheduler use the strong pull-up.</p>
+ * <p>Defining OW_SLEEP puts the MCU to sleep while waiting. The blocking wrappers of the timer-driven engine and the UART backend sleep in idle mode between the interrupts of the engine. OwConvertSleep() sleeps until the next sensor of the conversion scheduler is due, in power-down with the watchdog interrupt as wake source or, with OW_CONVERT_POWER, in idle mode until the strong pull-up is released, since Timer2 stops in power-down. Timers of the application stop in power-down too, so the returned tick includes the time slept. OwSleep() gives the same sleep for waits of the application. The watchdog runs from its own oscillator, whose period may be some percent off, so OW_CONVERT_POLL is recommended for conversions. The watchdog cannot be used as a system reset watchdog with OW_SLEEP.</p>
+ * @section uart_sec UART backend
+ * <p>Defining OW_UART drives the bus with the USART instead of OW_PORT. TX and RX are joined to the bus through an open-drain driver. Reset is written as one character at 9600 baud and every bit slot as one character at 115200 baud. The backend runs the same interrupt-driven engine as OW_ASYNC, so the blocking and asynchronous functions work unchanged and transfers complete in the RX complete interrupt. USART registers are selected in conf.h. Overdrive is not supported.</p>
+ * @section multi_sec Multiple buses
+ * <p>Defining OW_MULTI_BUS replaces OW_PORT, OW_PIN, OW_DIRECTION and OW_BIT with OwBus objects created with OW_BUS(). Each bus is initialized with OwInitBus() and the bus field of a context is set before searching. Functions taking a context select its bus, other functions work on the bus selected last with OwSelectBus(). Bus access goes through pointers, so a single bus without OW_MULTI_BUS keeps the constant SBI and CBI accesses. With OW_MULTI_BUS the direction and port registers are updated with read-modify-write, interrupts modifying the same port have to be blocked.</p>
+ * <p>Defining OW_PARALLEL enables the parallel slot engine for buses on pins of the same port. OwParallelReset(), OwParallelWriteByte() and OwParallelReadByte() run every slot on all buses of an OwParallelBus at once with a separate data bit for each bus, so a Convert T or scratchpad read on eight buses takes the bus time of one. Parallel functions are always blocking.</p>
+ * @section crc_sec CRC
+ * <p>OwCrc8() checks roms and scratchpads, a buffer ending with its crc gives 0x00. OwCrc16() checks DS24xx memory commands. Defining OW_CRC_TABLE or OW_CRC_NIBBLE trades program memory for speed. With OW_CRC_STREAM every byte read or written by the blocking functions after OwCrcStart() is added to the crcs so OwCrc8Result() is ready the moment the last byte arrives. Searches drop roms with invalid crc and restart with the next search.</p>
+ * @section timing_sec Timing
+ * <p>Slot delays are converted to cycle counts at compile time from F_CPU. Cycles spent in the bus primitives, sampling and byte loops (OW_BUS_CYCLES, OW_SAMPLE_CYCLES and OW_LOOP_CYCLES) are subtracted from the delays so slots keep their nominal length also at low clock speeds. The overhead constants can be overridden in conf.h if a compiler produces different code.</p>
+ * <p>Defining OW_CALIBRATION replaces the fixed standard speed sample point, recovery times and presence sample with values of the bus. OwInit() sets them to the fixed delays and OwCalibrate() measures the rise time after a reset pulse and the presence pulse window. Sampling is moved past the rise time, recovery is stretched to twice the rise time and presence is sampled in the middle of the measured window. Fast buses keep the minimum slot length while long and heavily loaded lines get the padding they need. With OW_MULTI_BUS each OwBus keeps its own timing.</p>
+ * <p>Defining OW_STATS counts resets, slots, bytes, retries, crc failures and search passes and accumulates bus busy time in ticks of OW_STATS_CLOCK(), a free-running timer of the application. OwStatsRead() copies the counters. OW_TRACE keeps the last OW_TRACE_SIZE resets, transaction results and search failures with their timestamps in a ring buffer read with OwTraceRead(). Both compile to nothing when not defined.</p>
+ * @section sim_sec Simulated bus
+ * <p>Defining OW_SIM builds the library for a PC. Bus registers and delays of the single bus are routed to onewire_sim.c, where delays advance a virtual clock and virtual slaves decode reset pulses and slots from the pin edges. OwSimAdd() attaches a slave, DS18B20 and DS2431 simulate their function commands and other families answer rom commands. OwSimRead() gives the resets, slots and bus time since OwSimClear(), so the cost of searches and transactions can be measured and compared without hardware. test/bench_sim.c runs searches over 1 to 64 devices, scratchpad sweeps and Match rom against Skip rom on the simulated bus and reports their counters. OW_ASYNC, OW_UART, OW_MULTI_BUS, OW_PARALLEL and the features using AVR peripherals are not available with the simulated bus.</p>
+ * @section bench_sec Benchmark
+ * <p>Defining OW_BENCH adds OwBenchRun(), which measures OwReset(), OwReadByte(), OwWriteByte(), OwWriteByteTo() and OwSearchRom() on the target. It reports the time each call blocks the caller, the bus time up to the last rising edge latched by Timer1 input capture, and the longest time a periodic Timer1 compare interrupt was held off. The last is the interrupts-masked time of the OW_BLOCK_INTERRUPTS mode of the build, so the firmware is built once per mode and the results are compared. ICP1 has to be connected to the bus. Timer1 is taken by the benchmark, which rules out OW_ASYNC and parts without 16-bit Timer1 input capture such as ATtiny85.</p>
+ * @section od_sec Overdrive
+ * <p>Defining OW_OVERDRIVE adds a second timing set for overdrive capable devices. After a standard speed OwReset() OwOverdriveSkipRom() or OwOverdriveMatchRom() moves devices to overdrive and the library follows them. Further resets and slots use overdrive timing until OwSetSpeed(OW_SPEED_STANDARD) and a standard speed reset return the bus to standard speed. Transactions select their speed with the speed field.</p>
  * @section int_comp Interrupt compatibility
  * <p>1-Wire read and write operations are time-sensitive and prone to failure if interrupts are being handled simultaneously with either type of operation. By default Interrupt Service Routines written in C tend to free a couple of registers and store SREG before even executing any user-written code. This sums up to 16 cycles (2 us with 8 MHz clock) of PUSH, POP, IN, OUT and CLR calls without the user-written interrupt handling. The shortest delay used in this library is 5 us long. This basically rules out all interrupts.</p>
  * <p> Interrupt handling during reset, read and write can be prevented by defining constant OW_BLOCK_INTERRUPTS which disables interrupts for the duration of the operation. OW_BLOCK_INTERRUPTS_BITLEVEL allows interrupts between separate bits and outside the wait time for presence pulse after reset pulse.</p>
+ * <p>Defining OW_RESET_EARLY ends a reset once the presence pulse is over, followed by a recovery as long as the presence sample delay, instead of waiting the whole 500 us reset high time. Without OW_RESET_EARLY the reset keeps its fixed length.</p>
+ * <p>Defining OW_EDGE adds capture of low pulses driven by slaves on an idle bus, such as the presence pulse of an iButton touching the reader or of a device attached at runtime. OwEdgeArm() enables the pin change interrupt of the bus pin and OwEdgeDisarm() disables it, the bus is not used while armed since the interrupt would fire on every slot. Each low pulse is timestamped with OW_STATS_CLOCK() and given to the callback from the interrupt, OwEdgeRead() returns the number of pulses since the last call and the last one. Pin change interrupts wake the MCU from every sleep mode, so an armed bus can wait for a device in power-down.</p>
+ * <p>OW_BLOCK_INTERRUPTS_SAMPLE masks interrupts only from the falling edge of a read slot to its sample point and for the low pulse of a one bit, about 10 us at standard speed. Recovery runs with interrupts enabled, a late recovery only lengthens the slot, which 1-Wire tolerates. The low pulse of a zero bit is not masked, an interrupt shorter than 60 us keeps it under its 120 us limit. The presence pulse is polled instead of sampled once, so an interrupt shorter than the presence pulse cannot hide it. Calibrated resets and parallel resets keep their sampling window masked. OwBenchRun() reports the resulting masked time.</p>
+ * @section async_sec Timer-driven engine
+ * <p>Defining OW_ASYNC moves slot timing to a Timer1 compare match interrupt. OwAsyncReset(), OwAsyncReadByte() and OwAsyncWriteByte() start an operation and return immediately. Completion is signaled by OwAsyncBusy() returning zero and by the optional callback which is called from the interrupt. Only the low pulse and sampling of a slot are spent inside the interrupt, the rest of the slot is left for the application. OwAsyncTransact() executes a transaction array from the interrupt with a single completion callback. The blocking functions wait for the engine and can be mixed with the asynchronous ones. Interrupts have to be enabled and OW_BLOCK_INTERRUPTS settings are ignored.</p>
  */
 
-#include <avr/io.h>
-#include <util/delay.h>
-#include "onewire.h"
+#include <string.h>
+#include "onewire_bus.h"
+
+#ifdef OW_MULTI_BUS
+	OwBus* ow_bus;				// bus used by the functions without context
+#elif defined(OW_OVERDRIVE)
+	uint8_t ow_speed = OW_SPEED_STANDARD;	// timing used by the bit primitives
+#endif
 
 /**
- * @fn static inline void OwWriteBusHigh(void)
- * @brief A static function for writing the bus to high state. Basically just releases the bus. If OW_INTERNAL_PULLUP is defined the internal pull-up resistor is used.
+ * @fn void OwInit(void)
+ * @brief initializes the bus. Used to call the static function OwWriteBusHigh() in non-static way.
  */
-static inline void OwWriteBusHigh(void) {
+void OwInit(void) {
+
+	#ifndef OW_UART
+		OwWriteBusHigh();
+		OW_BUS_PORT &= ~OW_BUS_MASK;
+	#endif
+
+	#ifdef OW_ASYNC
+		OwAsyncInit();
+	#endif
 
-	OW_DIRECTION &= ~(1 << OW_BIT);
-	#ifdef OW_INTERNAL_PULLUP
-		OW_PORT |= 1 << OW_BIT;
+	#ifdef OW_CALIBRATION
+		OwTimingDefaults();
 	#endif
 
 }
 
+#ifdef OW_MULTI_BUS
+
 /**
- * @fn static inline void OwWriteBusLow(void)
- * @brief A static function for writing the bus to low state.
+ * @fn void OwSelectBus(OwBus* bus)
+ * @brief Selects the bus used by the functions without context. Functions taking a context select the bus of the context themselves.
+ *
+ * @param bus		bus to be used
  */
-static inline void OwWriteBusLow(void) {
+void OwSelectBus(OwBus* bus) {
 
-	OW_DIRECTION |= 1 << OW_BIT;
-	#ifdef OW_INTERNAL_PULLUP
-		OW_PORT &= ~(1 << OW_BIT);
+	#ifdef OW_ASYNC
+		OwAsyncWait();
 	#endif
 
+	ow_bus = bus;
+
+}
+
+/**
+ * @fn void OwInitBus(OwBus* bus)
+ * @brief Selects and initializes a bus. Called once for each bus instead of OwInit().
+ *
+ * @param bus		bus to be initialized
+ */
+void OwInitBus(OwBus* bus) {
+
+	OwSelectBus(bus);
+	OwInit();
+
 }
 
+#endif
 
 /**
- * @fn void OwInit(void)
- * @brief initializes the bus. Used to call the static function OwWriteBusHigh() in non-static way.
+ * @fn static uint8_t OwResetRaw(void)
+ * @brief Writes reset pulse to the bus and checks for presence pulse. OW_BLOCK_INTERRUPTS is left to the caller.
+ *
+ * @return 0x01 if presence pulse is detected or 0x00 if no presence pulse is detected.
  */
-void OwInit(void) {
+static uint8_t OwResetRaw(void) {
+
+	#ifdef OW_STRONG_PULLUP
+		// reset ends the strong pull-up
+		if(ow_power_on) {
+			OwPowerRelease();
+		}
+	#endif
+
+	uint8_t presence;
+
+	OW_STAT_BEGIN();
+
+	#ifdef OW_ASYNC
+
+		OwAsyncStart(OW_OP_RESET, 0, 0, 0);
+		presence = OwAsyncWait();
 
-	OwWriteBusHigh();
-        OW_PORT &= ~(1 << OW_BIT);
+	#else
+
+		if(OW_IS_OVERDRIVE) {
+			presence = OwResetSlot(OW_OD_RESET_DELAY, OW_OD_PRESENCE_DELAY, OW_OD_RESET_DELAY - OW_OD_PRESENCE_DELAY);
+		} else {
+			#ifdef OW_CALIBRATION
+				presence = OwResetSlotTimed();
+			#else
+				presence = OwResetSlot(OW_RESET_DELAY, OW_LONG_DELAY, OW_RESET_DELAY - OW_LONG_DELAY);
+			#endif
+		}
+
+	#endif
+
+	OW_STAT_END();
+	OW_STAT_INC(resets);
+	OW_TRACE_EVENT(OW_TRACE_RESET, presence);
+
+	return presence;
 
 }
 
@@ -74,35 +178,42 @@ uint8_t OwReset(void) {
 		cli();
 	#endif
 
-	// drive bus low
-	OwWriteBusLow();
+	presence = OwResetRaw();
 
-	_delay_us(OW_RESET_DELAY);
-
-	#ifdef OW_BLOCK_INTERRUPTS_BITLEVEL
-		cli();
+	#ifdef OW_BLOCK_INTERRUPTS
+		sei();
 	#endif
-	// release bus
-	OwWriteBusHigh();
 
-	// wait for presence pulse
-	_delay_us(OW_LONG_DELAY);
+	return presence;
+}
 
-	// check for presence pulse
-	presence = (OW_PIN & (1 << OW_BIT)) >> OW_BIT;
+/**
+ * @fn uint8_t OwResetStatus(void)
+ * @brief Writes reset pulse to the bus and tells why it failed. Released bus is checked before the reset and again at the end of the presence window, a shorted line would otherwise look like a presence pulse.
+ *
+ * @return		OW_OK, OW_ERR_SHORT or OW_ERR_NO_PRESENCE
+ */
+uint8_t OwResetStatus(void) {
 
-	#ifdef OW_BLOCK_INTERRUPTS_BITLEVEL
-		sei();
+	uint8_t presence;
+
+	#ifndef OW_UART
+		if(!OwSampleBus()) {
+			return OW_ERR_SHORT;
+		}
 	#endif
 
-	_delay_us(OW_RESET_DELAY - OW_LONG_DELAY);
+	presence = OwReset();
 
-	#ifdef OW_BLOCK_INTERRUPTS
-		sei();
+	#ifndef OW_UART
+		// presence pulses are over well before the end of the reset slot
+		if(presence && !OwSampleBus()) {
+			return OW_ERR_SHORT;
+		}
 	#endif
 
-	// return 0x01 if presence pulse was read
-	return presence ^ 0x01;
+	return presence ? OW_OK : OW_ERR_NO_PRESENCE;
+
 }
 
 /**
@@ -113,38 +224,83 @@ uint8_t OwReset(void) {
  */
 static inline uint8_t OwReadBit(void) {
 
+	uint8_t bit;
+
+	OW_STAT_INC(slots);
+
+	#ifdef OW_ASYNC
+		OwAsyncStart(OW_OP_READ, 0, 1, 0);
+		return OwAsyncWait();
+	#endif
+
+	OW_STAT_BEGIN();
+
 	#ifdef OW_BLOCK_INTERRUPTS_BITLEVEL
 		cli();
 	#endif
 
-	// drive bus low
-	OwWriteBusLow();
-	_delay_us(OW_SHORT_DELAY);
+	if(OW_IS_OVERDRIVE) {
+		bit = OwReadSlot(OW_OD_SHORT_DELAY, OW_OD_SAMPLE_DELAY, OW_OD_LONG_DELAY - OW_OD_SAMPLE_DELAY);
+	} else {
+		#ifdef OW_CALIBRATION
+			bit = OwReadSlotTimed();
+		#else
+			bit = OwReadSlot(OW_SHORT_DELAY, OW_SAMPLE_DELAY, OW_LONG_DELAY - OW_SAMPLE_DELAY);
+		#endif
+	}
+
+	#ifdef OW_BLOCK_INTERRUPTS_BITLEVEL
+		sei();
+	#endif
+
+	OW_STAT_END();
+
+	return bit;
+
+}
+
+/**
+ * @fn static uint8_t OwReadByteRaw(void)
+ * @brief Reads a byte from the bus. OW_BLOCK_INTERRUPTS is left to the caller.
+ *
+ * @return byte read from the bus
+ */
+static uint8_t OwReadByteRaw(void) {
 
-	// release bus
-	OwWriteBusHigh();
-	_delay_us(OW_SAMPLE_DELAY);
+	uint8_t data = 0;
 
-	// read bit and return the value as LSB
-	if(OW_PIN & (1 << OW_BIT)) {
+	OW_STAT_INC(bytes);
 
-	        _delay_us(OW_LONG_DELAY - OW_SAMPLE_DELAY);
-	        #ifdef OW_BLOCK_INTERRUPTS_BITLEVEL
-		        sei();
-        	#endif
-		return 0x01;
+	#ifdef OW_ASYNC
 
-	} else {
+		OW_STAT_BEGIN();
+		OwAsyncStart(OW_OP_READ, 0, 8, 0);
+		data = OwAsyncWait();
+		OW_STAT_END();
+		OW_STAT_ADD(slots, 8);
 
-	        _delay_us(OW_LONG_DELAY - OW_SAMPLE_DELAY);
-	        #ifdef OW_BLOCK_INTERRUPTS_BITLEVEL
-		        sei();
-        	#endif
-		return 0x00;
+	#else
 
-	}
+		uint8_t i;
+
+		// 8 consecutive bits are read from bus and arranged into a variable LSB first.
+		// Bits are shifted in from MSB to keep the loop overhead constant.
+		for(i = 0; i < 8; i++) {
 
+			data >>= 1;
 
+			if(OwReadBit()) {
+				data |= 0x80;
+			}
+
+		}
+
+	#endif
+
+	// crc is ready as soon as the last byte has arrived
+	OwCrcStream(data);
+
+	return data;
 
 }
 
@@ -156,20 +312,13 @@ static inline uint8_t OwReadBit(void) {
  */
 uint8_t OwReadByte(void) {
 
+	uint8_t data;
+
 	#ifdef OW_BLOCK_INTERRUPTS
 		cli();
 	#endif
 
-	uint8_t i;
-
-	uint8_t data = 0;
-
-	// 8 consecutive bits are read from bus and arranged into a variable LSB first
-	for(i = 0; i < 8; i++) {
-
-		data |= OwReadBit() << i;
-
-	}
+	data = OwReadByteRaw();
 
 	#ifdef OW_BLOCK_INTERRUPTS
 		sei();
@@ -187,35 +336,69 @@ uint8_t OwReadByte(void) {
  */
 static inline void OwWriteBit(uint8_t data) {
 
+	OW_STAT_INC(slots);
+
+	#ifdef OW_ASYNC
+		OwAsyncStart(OW_OP_WRITE, data, 1, 0);
+		OwAsyncWait();
+		return;
+	#endif
+
+	OW_STAT_BEGIN();
+
 	#ifdef OW_BLOCK_INTERRUPTS_BITLEVEL
 		cli();
 	#endif
 
-	// LSB of data value is checked
-	if(data & 1) {
+	if(OW_IS_OVERDRIVE) {
+		OwWriteSlot(data, OW_OD_SHORT_DELAY, OW_OD_LONG_DELAY);
+	} else {
+		#ifdef OW_CALIBRATION
+			OwWriteSlotTimed(data);
+		#else
+			OwWriteSlot(data, OW_SHORT_DELAY, OW_LONG_DELAY);
+		#endif
+	}
+
+	#ifdef OW_BLOCK_INTERRUPTS_BITLEVEL
+		sei();
+	#endif
 
-		// drive bus low
-		OwWriteBusLow();
-		_delay_us(OW_SHORT_DELAY);
+	OW_STAT_END();
 
-		// release bus
-		OwWriteBusHigh();
-		_delay_us(OW_LONG_DELAY);
+}
 
-	} else {
+/**
+ * @fn static void OwWriteByteRaw(uint8_t data)
+ * @brief Writes a byte to the bus. OW_BLOCK_INTERRUPTS is left to the caller.
+ *
+ * @param data		byte to be written to the bus
+ */
+static void OwWriteByteRaw(uint8_t data) {
 
-		// drive bus low
-		OwWriteBusLow();
-		_delay_us(OW_LONG_DELAY);
+	OwCrcStream(data);
+	OW_STAT_INC(bytes);
 
-		// release bus
-		OwWriteBusHigh();
-		_delay_us(OW_SHORT_DELAY);
+	#ifdef OW_ASYNC
 
-	}
+		OW_STAT_BEGIN();
+		OwAsyncStart(OW_OP_WRITE, data, 8, 0);
+		OwAsyncWait();
+		OW_STAT_END();
+		OW_STAT_ADD(slots, 8);
+
+	#else
+
+		uint8_t i;
+
+		// data byte is written to the bus one bit at a time starting from LSB
+		for(i = 0; i < 8; i++) {
+
+			OwWriteBit(data);
+			data >>= 1;
+
+		}
 
-	#ifdef OW_BLOCK_INTERRUPTS_BITLEVEL
-		sei();
 	#endif
 
 }
@@ -232,14 +415,31 @@ void OwWriteByte(uint8_t data) {
 		cli();
 	#endif
 
-	uint8_t i;
+	OwWriteByteRaw(data);
 
-	// data byte is written to the bus one bit at a time starting from LSB
-	for(i = 0; i < 8; i++) {
+	#ifdef OW_BLOCK_INTERRUPTS
+		sei();
+	#endif
+
+}
 
-		OwWriteBit(data >> i);
+#ifdef OW_STRONG_PULLUP
 
-	}
+/**
+ * @fn void OwWriteBytePower(uint8_t data, uint16_t ms)
+ * @brief Writes a byte to the bus and drives the bus high right after the last bit. Timer releases the bus after given time without blocking. Bus functions must not be used while OwPowerActive() returns 0x01, a reset releases the bus early.
+ *
+ * @param data		byte to be written, e.g. OW_CONVERT_T or OW_COPY_SCRATCHPAD
+ * @param ms		time to keep the bus powered in milliseconds
+ */
+void OwWriteBytePower(uint8_t data, uint16_t ms) {
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		cli();
+	#endif
+
+	OwWriteByteRaw(data);
+	OwPowerStart(ms);
 
 	#ifdef OW_BLOCK_INTERRUPTS
 		sei();
@@ -247,6 +447,8 @@ void OwWriteByte(uint8_t data) {
 
 }
 
+#endif
+
 /**
  * @fn void OwWriteByteTo(uint8_t data, uint8_t rom)
  * @brief Writes a Match Rom command, rom and byte to the 1-wire bus. Although this function itself calls OwReset before writing given byte it is still required to manually call OwReset before this function. This way every function has the same call sequence.
@@ -256,6 +458,39 @@ void OwWriteByte(uint8_t data) {
  */
 void OwWriteByteTo(OwContext* ctx, uint8_t rom, uint8_t data) {
 
+	OW_SELECT_CTX(ctx);
+
+	// the only device does not need its rom
+	if(OwSkipSingle(ctx)) {
+
+		#ifdef OW_BLOCK_INTERRUPTS
+			cli();
+		#endif
+
+		OwWriteByteRaw(OW_SKIP_ROM);
+		OwWriteByteRaw(data);
+
+		#ifdef OW_BLOCK_INTERRUPTS
+			sei();
+		#endif
+
+		return;
+
+	}
+
+	OwWriteByteToRom(ctx->roms[rom], data);
+
+}
+
+/**
+ * @fn void OwWriteByteToRom(const uint8_t* rom, uint8_t data)
+ * @brief Writes a Match Rom command, given rom and byte to the selected bus. OwReset has to be called before this function.
+ *
+ * @param rom		8-byte rom, e.g. unpacked with OwPackedRom()
+ * @param data		byte to be written to the 1-wire bus
+ */
+void OwWriteByteToRom(const uint8_t* rom, uint8_t data) {
+
 	#ifdef OW_BLOCK_INTERRUPTS
 		cli();
 	#endif
@@ -263,15 +498,15 @@ void OwWriteByteTo(OwContext* ctx, uint8_t rom, uint8_t data) {
 	uint8_t i;
 
 	// Match rom command is written to the bus
-	OwWriteByte(OW_MATCH_ROM);
+	OwWriteByteRaw(OW_MATCH_ROM);
 
 	// Bytes of the selected rom are written one by one to the bus
 	for(i = 0; i < 8; i++) {
-		OwWriteByte(ctx->roms[rom][i]);
+		OwWriteByteRaw(rom[i]);
 	}
 
 	// given data is written to the bus
-	OwWriteByte(data);
+	OwWriteByteRaw(data);
 
 	#ifdef OW_BLOCK_INTERRUPTS
 		sei();
@@ -280,137 +515,1117 @@ void OwWriteByteTo(OwContext* ctx, uint8_t rom, uint8_t data) {
 }
 
 /**
- * @fn uint8_t OwSearchRom(void)
- * @brief Search roms of all devices connected to the bus. Brute force method is used which
- * makes this procedure extremely slow. Interrupt blocking does not apply to this function
- * above bit level. Call sei() after searching roms if interrupts are used.
+ * @fn uint8_t OwCommand(OwContext* ctx, uint8_t rom, uint8_t command)
+ * @brief Resets the bus of a context, selects a device and writes a function command.
  *
- * @return		number of roms found.
+ * @param ctx		context holding the roms
+ * @param rom		index of the rom in context or OW_TXN_SKIP_ROM
+ * @param command	function command
+ *
+ * @return		0x01 if presence pulse was detected, otherwise 0x00 and nothing is written.
  */
-uint8_t OwSearchRom(OwContext* ctx) {
+uint8_t OwCommand(OwContext* ctx, uint8_t rom, uint8_t command) {
 
-	uint8_t input = 0; 		// value read from bus
-	uint8_t output = 0;		// LSB = bit to write to bus
+	OW_SELECT_CTX(ctx);
 
-	uint32_t diff = 0;		// difference stack
-	uint8_t diff_index = 0;		// difference stack pointer
+	if(!OwReset()) {
+		return 0;
+	}
+
+	if(rom == OW_TXN_SKIP_ROM) {
+		OwWriteByte(OW_SKIP_ROM);
+		OwWriteByte(command);
+	} else {
+		OwWriteByteTo(ctx, rom, command);
+	}
 
-	uint8_t temp_byte;
+	return 1;
 
-	uint8_t i, j, k;
+}
+
+#ifdef OW_CONTEXT_BUFFER
 
-	// iterate
-	for(i = 0; i < OW_MAX_ROMS; i++) {
+/**
+ * @fn void OwContextInit(OwContext* ctx, uint8_t* buf, uint8_t capacity)
+ * @brief Initializes a context storing its roms in given buffer.
+ *
+ * @param ctx		context to initialize
+ * @param buf		buffer of OW_CONTEXT_BUFFER_SIZE(capacity) bytes
+ * @param capacity	number of roms fitting in the buffer
+ */
+void OwContextInit(OwContext* ctx, uint8_t* buf, uint8_t capacity) {
 
-		diff_index = 0;	// reset difference pointer
+	memset(ctx, 0, sizeof(OwContext));
 
-		// search rom
-		for(j = 0; j < 8; j++) {
+	ctx->roms = (uint8_t (*)[8])buf;
+	ctx->resolution = buf + capacity * 8;
+	#ifdef OW_ROM_INDEX
+		ctx->order = buf + capacity * 9;
+	#endif
+	ctx->capacity = capacity;
 
-			temp_byte = 0;
+}
 
-			for(k = 0; k < 8; k++) {
+#endif
 
-				if(j == 0 && k == 0) {	// New search sequence is started for every rom.
-										// This is started on the first loop.
-					OwReset();
-					OwWriteByte(OW_SEARCH_ROM);
+#ifndef OW_ASYNC
 
-				} else {				// Following loops output selected bit to the bus.
+// one read slot of an unrolled byte, bits are shifted in from MSB
+#define OW_READ_BIT_UNROLLED(data)	do { (data) >>= 1; if(OwReadBit()) { (data) |= 0x80; } } while(0)
+// one write slot of an unrolled byte, bits are written from LSB
+#define OW_WRITE_BIT_UNROLLED(data)	do { OwWriteBit(data); (data) >>= 1; } while(0)
 
-					OwWriteBit(output);
+#endif
 
-				}
+/**
+ * @fn uint8_t OwReadBlockUntil(uint8_t* buf, uint8_t len, OwBlockCallback cont)
+ * @brief Reads bytes from the bus into a buffer within a single OW_BLOCK_INTERRUPTS window. Bit slots of each byte are unrolled.
+ *
+ * @param buf		buffer for the bytes
+ * @param len		number of bytes to read
+ * @param cont		called after each byte, returning 0x00 stops the read; 0 reads all bytes
+ *
+ * @return number of bytes read
+ */
+uint8_t OwReadBlockUntil(uint8_t* buf, uint8_t len, OwBlockCallback cont) {
 
-				// Address bit and its complement are read
-				input = OwReadBit();
-				input <<= 1;
-				input |= OwReadBit();
+	uint8_t pos = 0;
+	uint8_t data;
 
-				// Handling of the address bit and its complement
-				switch(input) {
+	#ifdef OW_BLOCK_INTERRUPTS
+		cli();
+	#endif
 
-					// conflict
-					case 0:
+	while(pos < len) {
 
-						// Move difference pointer forward and selection the value in
-						// difference stack.
-						diff_index++;
+		#ifdef OW_ASYNC
 
-						if(diff & 1 << diff_index) {
+			data = OwReadByteRaw();
 
-							output = 1;
-							temp_byte |= 1 << k;
+		#else
 
-						} else {
+			data = 0;
 
-							output = 0;
+			OW_READ_BIT_UNROLLED(data);
+			OW_READ_BIT_UNROLLED(data);
+			OW_READ_BIT_UNROLLED(data);
+			OW_READ_BIT_UNROLLED(data);
+			OW_READ_BIT_UNROLLED(data);
+			OW_READ_BIT_UNROLLED(data);
+			OW_READ_BIT_UNROLLED(data);
+			OW_READ_BIT_UNROLLED(data);
 
-						}
+			OwCrcStream(data);
+			OW_STAT_INC(bytes);
 
-						break;
+		#endif
 
-					// zero bit
-					case 1:
+		buf[pos++] = data;
 
-						output = 0;				// Temp_byte already contains a zero in this index.
-						break;
+		if(cont && !cont(pos - 1, data)) {
+			break;
+		}
 
-					// one bit
-					case 2:
+	}
 
-						output = 1;
-						temp_byte |= 1 << k;	// The bit in temp_byte is set high.
-						break;
+	#ifdef OW_BLOCK_INTERRUPTS
+		sei();
+	#endif
 
-					// no devices - error state
-					// This state is reached only if no devices are connected or the bus dies during rom search
-					case 3:
+	return pos;
 
-						return 0;				// Either there are no devices or bus won't function.
-												// Zero is returned as device count to indicate this.
-				}
+}
 
-			}
+/**
+ * @fn uint8_t OwReadStream(uint8_t len, OwBlockCallback cont)
+ * @brief Reads bytes from the bus within a single OW_BLOCK_INTERRUPTS window and gives each one to a callback without storing it, so long reads need no buffer.
+ *
+ * @param len		number of bytes to read
+ * @param cont		called after each byte, returning 0x00 stops the read
+ *
+ * @return number of bytes read
+ */
+uint8_t OwReadStream(uint8_t len, OwBlockCallback cont) {
 
-			// Byte is stored to static array
-			ctx->roms[i][j] = temp_byte;
+	uint8_t pos = 0;
 
+	#ifdef OW_BLOCK_INTERRUPTS
+		cli();
+	#endif
+
+	while(pos < len) {
+
+		if(!cont(pos++, OwReadByteRaw())) {
+			break;
 		}
 
-		// Full rom is found at this point.
-		if(diff & (1 << diff_index)) {			// If current index in difference stack contains a one
-												// it is set to zero along with all adjacent ones.
-			j = 0;
+	}
 
-			while(diff & (1 << (diff_index - j))) {
+	#ifdef OW_BLOCK_INTERRUPTS
+		sei();
+	#endif
 
-				diff &= ~(1 << (diff_index - j));
+	return pos;
 
-				j++;
+}
 
-			}
+/**
+ * @fn uint8_t OwReadBlock(uint8_t* buf, uint8_t len)
+ * @brief Reads bytes from the bus into a buffer.
+ *
+ * @param buf		buffer for the bytes
+ * @param len		number of bytes to read
+ *
+ * @return number of bytes read
+ */
+uint8_t OwReadBlock(uint8_t* buf, uint8_t len) {
 
-			diff |= 1 << (diff_index - j);		// The first zero found is set to one.
+	return OwReadBlockUntil(buf, len, 0);
 
-		} else {								// If current index in difference stack contains a zero
-												// it is set to one.
-			diff |= 1 << diff_index;
+}
 
-		}
+/**
+ * @fn uint8_t OwWriteBlockUntil(const uint8_t* buf, uint8_t len, OwBlockCallback cont)
+ * @brief Writes bytes from a buffer to the bus within a single OW_BLOCK_INTERRUPTS window. Bit slots of each byte are unrolled.
+ *
+ * @param buf		bytes to write
+ * @param len		number of bytes to write
+ * @param cont		called after each byte, returning 0x00 stops the write; 0 writes all bytes
+ *
+ * @return number of bytes written
+ */
+uint8_t OwWriteBlockUntil(const uint8_t* buf, uint8_t len, OwBlockCallback cont) {
 
-		if(diff & 1) {							// First bit set as one indicates finished search.
+	uint8_t pos = 0;
+	uint8_t data;
 
-			break;
+	#ifdef OW_BLOCK_INTERRUPTS
+		cli();
+	#endif
+
+	while(pos < len) {
+
+		data = buf[pos++];
+
+		#ifdef OW_ASYNC
+
+			OwWriteByteRaw(data);
+
+		#else
+
+			OwCrcStream(data);
+			OW_STAT_INC(bytes);
 
+			OW_WRITE_BIT_UNROLLED(data);
+			OW_WRITE_BIT_UNROLLED(data);
+			OW_WRITE_BIT_UNROLLED(data);
+			OW_WRITE_BIT_UNROLLED(data);
+			OW_WRITE_BIT_UNROLLED(data);
+			OW_WRITE_BIT_UNROLLED(data);
+			OW_WRITE_BIT_UNROLLED(data);
+			OW_WRITE_BIT_UNROLLED(data);
+
+		#endif
+
+		if(cont && !cont(pos - 1, buf[pos - 1])) {
+			break;
 		}
 
 	}
 
-        // If number of connected devices is equal to or greater than OW_MAX_ROMS
-        // i will be OW_MAX_ROMS + 1 at the end of this loop.
-        if(i == OW_MAX_ROMS) return OW_MAX_ROMS;
+	#ifdef OW_BLOCK_INTERRUPTS
+		sei();
+	#endif
+
+	return pos;
+
+}
+
+/**
+ * @fn uint8_t OwWriteBlock(const uint8_t* buf, uint8_t len)
+ * @brief Writes bytes from a buffer to the bus.
+ *
+ * @param buf		bytes to write
+ * @param len		number of bytes to write
+ *
+ * @return number of bytes written
+ */
+uint8_t OwWriteBlock(const uint8_t* buf, uint8_t len) {
+
+	return OwWriteBlockUntil(buf, len, 0);
+
+}
+
+/**
+ * @fn uint8_t OwReadScratchpadStatus(OwContext* ctx, uint8_t rom, uint8_t* buf, uint8_t len, uint8_t verify)
+ * @brief Resets the bus, selects a device and reads the first bytes of its scratchpad. The transfer is ended with a reset after the last byte needed, so reading only the temperature of DS18B20 skips seven byte times. With verify set the rest of the scratchpad is clocked through the crc without storing it.
+ *
+ * @param ctx		context holding the roms
+ * @param rom		index of the rom in context or OW_TXN_SKIP_ROM
+ * @param buf		buffer for the bytes
+ * @param len		number of bytes to read, at most OW_SCRATCHPAD_SIZE
+ * @param verify	0x01 to read through the crc byte and check it
+ *
+ * @return		OW_OK, OW_ERR_NO_PRESENCE or OW_ERR_CRC
+ */
+uint8_t OwReadScratchpadStatus(OwContext* ctx, uint8_t rom, uint8_t* buf, uint8_t len, uint8_t verify) {
+
+	uint8_t i;
+	uint8_t data;
+	uint8_t crc = 0;
+	uint8_t result = OW_ERR_NO_PRESENCE;
+
+	OW_SELECT_CTX(ctx);
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		cli();
+	#endif
+
+	if(OwResetRaw()) {
+
+		if(rom == OW_TXN_SKIP_ROM || OwSkipSingle(ctx)) {
+
+			OwWriteByteRaw(OW_SKIP_ROM);
+
+		} else {
+
+			OwWriteByteRaw(OW_MATCH_ROM);
+
+			for(i = 0; i < 8; i++) {
+				OwWriteByteRaw(ctx->roms[rom][i]);
+			}
+
+		}
+
+		OwWriteByteRaw(OW_READ_SCRATCHPAD);
+
+		if(!verify && len > OW_SCRATCHPAD_SIZE) {
+			len = OW_SCRATCHPAD_SIZE;
+		}
+
+		for(i = 0; i < (verify ? OW_SCRATCHPAD_SIZE : len); i++) {
+
+			data = OwReadByteRaw();
+			crc = OwCrc8Update(crc, data);
+
+			if(i < len) {
+				buf[i] = data;
+			}
+
+		}
+
+		// zero crc over the whole scratchpad including its crc byte
+		result = verify && crc ? OW_ERR_CRC : OW_OK;
+
+		if(result == OW_ERR_CRC) {
+			OW_STAT_INC(crc_errors);
+		}
+
+		// device stops sending on reset, not needed after the crc byte
+		if(!verify && len < OW_SCRATCHPAD_SIZE) {
+			OwResetRaw();
+		}
+
+	}
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		sei();
+	#endif
+
+	return result;
+
+}
+
+/**
+ * @fn uint8_t OwReadScratchpad(OwContext* ctx, uint8_t rom, uint8_t* buf, uint8_t len, uint8_t verify)
+ * @brief Same as OwReadScratchpadStatus() without telling why a read failed.
+ *
+ * @param ctx		context holding the roms
+ * @param rom		index of the rom in context or OW_TXN_SKIP_ROM
+ * @param buf		buffer for the bytes
+ * @param len		number of bytes to read, at most OW_SCRATCHPAD_SIZE
+ * @param verify	0x01 to read through the crc byte and check it
+ *
+ * @return		0x01 if presence pulse was detected and the crc matched when verified, otherwise 0x00.
+ */
+uint8_t OwReadScratchpad(OwContext* ctx, uint8_t rom, uint8_t* buf, uint8_t len, uint8_t verify) {
+
+	return OwReadScratchpadStatus(ctx, rom, buf, len, verify) == OW_OK;
+
+}
+
+#ifdef OW_OVERDRIVE
+
+/**
+ * @fn void OwSetSpeed(uint8_t speed)
+ * @brief Selects timing used by the following operations. Devices return to standard speed on a standard speed reset.
+ *
+ * @param speed		OW_SPEED_STANDARD or OW_SPEED_OVERDRIVE
+ */
+void OwSetSpeed(uint8_t speed) {
+
+	#ifdef OW_ASYNC
+		OwAsyncWait();
+	#endif
+
+	OW_SPEED = speed;
+
+}
+
+/**
+ * @fn uint8_t OwGetSpeed(void)
+ * @brief Returns the timing currently used.
+ *
+ * @return OW_SPEED_STANDARD or OW_SPEED_OVERDRIVE
+ */
+uint8_t OwGetSpeed(void) {
+
+	return OW_SPEED;
+
+}
+
+/**
+ * @fn void OwOverdriveSkipRom(void)
+ * @brief Writes Overdrive skip rom command and switches to overdrive speed. All overdrive capable devices stay in overdrive until a standard speed reset. Standard speed OwReset() has to be called before this function.
+ */
+void OwOverdriveSkipRom(void) {
+
+	OwWriteByte(OW_OVERDRIVE_SKIP_ROM);
+	OwSetSpeed(OW_SPEED_OVERDRIVE);
+
+}
+
+/**
+ * @fn void OwOverdriveMatchRom(OwContext* ctx, uint8_t rom)
+ * @brief Writes Overdrive match rom command at standard speed and the rom at overdrive speed. Only the selected device enters overdrive. Standard speed OwReset() has to be called before this function.
+ *
+ * @param ctx		context holding the roms
+ * @param rom		index of the rom in static storage
+ */
+void OwOverdriveMatchRom(OwContext* ctx, uint8_t rom) {
+
+	uint8_t i;
+
+	OW_SELECT_CTX(ctx);
+
+	OwWriteByte(OW_OVERDRIVE_MATCH_ROM);
+	OwSetSpeed(OW_SPEED_OVERDRIVE);
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		cli();
+	#endif
+
+	for(i = 0; i < 8; i++) {
+		OwWriteByteRaw(ctx->roms[rom][i]);
+	}
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		sei();
+	#endif
+
+}
+
+#endif
+
+/**
+ * @fn uint8_t OwTxnNext(OwTxnCursor* cur, uint8_t* data)
+ * @brief Selects the next bus operation of a transaction queue. Shared by OwTransact() and the timer-driven engine.
+ *
+ * @param cur		position in the transaction queue
+ * @param data		set to the byte to be written for OW_OP_WRITE
+ *
+ * @return		OW_OP_RESET, OW_OP_READ, OW_OP_WRITE or OW_OP_DONE
+ */
+uint8_t OwTxnNext(OwTxnCursor* cur, uint8_t* data) {
+
+	OwTransaction* txn;
+
+	while(cur->count) {
+
+		txn = cur->txn;
+
+		switch(cur->stage) {
+
+			case OW_TXN_STAGE_RESET:
+
+				// timing of the whole transaction follows the reset
+				#ifdef OW_OVERDRIVE
+					OW_SPEED = txn->speed;
+				#endif
+				cur->crc = 0;
+				return OW_OP_RESET;
+
+			case OW_TXN_STAGE_SELECT:
+
+				*data = txn->rom == OW_TXN_SKIP_ROM || OwSkipSingle(cur->ctx) ? OW_SKIP_ROM : OW_MATCH_ROM;
+				return OW_OP_WRITE;
+
+			case OW_TXN_STAGE_ROM:
+
+				if(txn->rom != OW_TXN_SKIP_ROM && !OwSkipSingle(cur->ctx) && cur->pos < 8) {
+					*data = cur->ctx->roms[txn->rom][cur->pos];
+					return OW_OP_WRITE;
+				}
+				break;
+
+			case OW_TXN_STAGE_WRITE:
+
+				if(cur->pos < txn->write_len) {
+					*data = txn->write[cur->pos];
+					return OW_OP_WRITE;
+				}
+				break;
+
+			case OW_TXN_STAGE_READ:
+
+				if(cur->pos < txn->read_len) {
+					return OW_OP_READ;
+				}
+				break;
+
+			default:
+
+				if(!txn->presence) {
+					txn->status = OW_ERR_NO_PRESENCE;
+				} else if((txn->flags & OW_TXN_CRC8) && cur->crc) {
+					txn->status = OW_ERR_CRC;
+					OW_STAT_INC(crc_errors);
+				} else {
+					txn->status = OW_OK;
+				}
+
+				OW_TRACE_EVENT(OW_TRACE_TXN, txn->status);
+
+				#if OW_TXN_RETRIES > 0
+					// only the failing transaction is repeated
+					if(txn->status != OW_OK && cur->retry < OW_TXN_RETRIES) {
+
+						cur->found -= txn->presence;
+						cur->retry++;
+						OW_STAT_INC(retries);
+						cur->backoff = cur->retry;
+						cur->stage = OW_TXN_STAGE_RESET;
+						continue;
+
+					}
+				#endif
+
+				// transaction finished, continue with the next one
+				cur->txn++;
+				cur->count--;
+				cur->retry = 0;
+				cur->stage = OW_TXN_STAGE_RESET;
+				continue;
+
+		}
+
+		cur->stage++;
+		cur->pos = 0;
+
+	}
+
+	return OW_OP_DONE;
+
+}
+
+/**
+ * @fn void OwTxnResult(OwTxnCursor* cur, uint8_t result)
+ * @brief Stores the result of the operation selected by OwTxnNext().
+ *
+ * @param cur		position in the transaction queue
+ * @param result	presence for reset, byte read for read
+ */
+void OwTxnResult(OwTxnCursor* cur, uint8_t result) {
+
+	OwTransaction* txn = cur->txn;
+
+	switch(cur->stage) {
+
+		case OW_TXN_STAGE_RESET:
+
+			// without presence the rest of the transaction is skipped
+			txn->presence = result;
+			cur->found += result;
+			cur->stage = result ? OW_TXN_STAGE_SELECT : OW_TXN_STAGE_END;
+			break;
+
+		case OW_TXN_STAGE_SELECT:
+
+			cur->stage++;
+			break;
+
+		case OW_TXN_STAGE_READ:
+
+			txn->read[cur->pos] = result;
+			cur->crc = OwCrc8Update(cur->crc, result);
+			cur->pos++;
+			break;
+
+		default:
+
+			cur->pos++;
+			break;
+
+	}
+
+}
+
+/**
+ * @fn static void OwTxnBackoff(uint8_t retry)
+ * @brief Waits before a retried transaction. Wait doubles with each retry. Interrupts blocked by OW_BLOCK_INTERRUPTS are served during the wait.
+ *
+ * @param retry		number of the retry, starting from 1
+ */
+static void OwTxnBackoff(uint8_t retry) {
+
+	uint8_t i;
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		sei();
+	#endif
+
+	for(i = 0; i < (uint8_t)(1 << (retry - 1)); i++) {
+		OwDelay(OW_TXN_BACKOFF_US, 0);
+	}
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		cli();
+	#endif
+
+}
+
+/**
+ * @fn uint8_t OwTransact(OwContext* ctx, OwTransaction* txn, uint8_t count)
+ * @brief Executes a queue of transactions back-to-back. Each transaction consists of reset, rom selection, written bytes and read bytes. With OW_BLOCK_INTERRUPTS interrupts are disabled once for the whole queue.
+ *
+ * @param ctx		context holding the roms
+ * @param txn		array of transactions
+ * @param count		number of transactions
+ *
+ * @return		number of transactions which got a presence pulse
+ */
+uint8_t OwTransact(OwContext* ctx, OwTransaction* txn, uint8_t count) {
+
+	OW_SELECT_CTX(ctx);
+
+	#ifdef OW_ASYNC
+		OwAsyncTransact(ctx, txn, count, 0);
+		return OwAsyncWait();
+	#endif
+
+	OwTxnCursor cur = { ctx, txn, count, OW_TXN_STAGE_RESET, 0, 0, 0, 0, 0 };
+	uint8_t data = 0;
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		cli();
+	#endif
+
+	for(;;) {
+
+		switch(OwTxnNext(&cur, &data)) {
+
+			case OW_OP_RESET:
+
+				if(cur.backoff) {
+
+					OwTxnBackoff(cur.backoff);
+					cur.backoff = 0;
+
+				}
+
+				OwTxnResult(&cur, OwResetRaw());
+				continue;
+
+			case OW_OP_WRITE:
+
+				OwWriteByteRaw(data);
+				OwTxnResult(&cur, 0);
+				continue;
+
+			case OW_OP_READ:
+
+				OwTxnResult(&cur, OwReadByteRaw());
+				continue;
+
+		}
+
+		break;
+
+	}
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		sei();
+	#endif
+
+	return cur.found;
+
+}
+
+/**
+ * @fn static void OwSearchClear(OwContext* ctx)
+ * @brief Clears the search state so the next search starts from the beginning.
+ *
+ * @param ctx		context holding the search state
+ */
+static void OwSearchClear(OwContext* ctx) {
+
+	ctx->search.last_discrepancy = 0;
+	ctx->search.last_family_discrepancy = 0;
+	ctx->search.last_device = 0;
+
+}
+
+/**
+ * @fn static uint8_t OwSearchPass(OwContext* ctx, uint8_t command)
+ * @brief Single pass of the search algorithm described in Maxim application note 187. The next rom after the one in search state is walked in one 64-bit pass. Interrupt blocking does not apply to this function above bit level.
+ *
+ * @param ctx		context holding the search state
+ * @param command	search command written after reset
+ *
+ * @return		0x01 if a rom was found into ctx->search.rom, otherwise 0x00.
+ */
+static uint8_t OwSearchPass(OwContext* ctx, uint8_t command) {
+
+	OwSearchState* s = &ctx->search;
+
+	uint8_t bit_number = 1;		// 1-based index of the current rom bit
+	uint8_t last_zero = 0;		// last conflict where zero was selected
+	uint8_t byte = 0;		// current rom byte
+	uint8_t mask = 1;		// current bit in rom byte
+
+	uint8_t input;			// address bit and its complement
+	uint8_t direction;		// bit written to the bus
+
+	OW_SELECT_CTX(ctx);
+
+	s->status = OW_OK;
+
+	// previous pass found the last device
+	if(s->last_device) {
+
+		OwSearchClear(ctx);
+		return 0;
+
+	}
+
+	if(!OwReset()) {
+
+		s->status = OW_ERR_NO_PRESENCE;
+		OwSearchClear(ctx);
+		return 0;
+
+	}
+
+	OwWriteByte(command);
+	OW_STAT_INC(search_passes);
+
+	do {
+
+		// Address bit and its complement are read
+		input = OwReadBit();
+		input <<= 1;
+		input |= OwReadBit();
+
+		// no devices - error state
+		// This state is reached only if no devices are connected or the bus dies during rom search
+		if(input == 3) {
+			break;
+		}
+
+		if(input) {
+
+			// all remaining devices have the same bit, bit is the address bit
+			direction = input >> 1;
+
+		} else {
+
+			// conflict, follow the previous rom up to the last discrepancy,
+			// take one branch on it and zero branches after it
+			if(bit_number < s->last_discrepancy) {
+
+				direction = (s->rom[byte] & mask) ? 1 : 0;
+
+			} else {
+
+				direction = bit_number == s->last_discrepancy;
+
+			}
+
+			if(!direction) {
+
+				last_zero = bit_number;
+
+				if(last_zero < 9) {
+					s->last_family_discrepancy = last_zero;
+				}
+
+			}
+
+		}
+
+		if(direction) {
+			s->rom[byte] |= mask;
+		} else {
+			s->rom[byte] &= ~mask;
+		}
+
+		// selected bit is written to drop devices of the other branch
+		OwWriteBit(direction);
+
+		bit_number++;
+		mask <<= 1;
+
+		if(!mask) {
+
+			byte++;
+			mask = 1;
+
+		}
+
+	} while(byte < 8);
+
+	// bus fault before all 64 bits were read or corrupted rom
+	if(byte < 8 || !s->rom[0] || OwCrc8(s->rom, 8)) {
+
+		s->status = byte < 8 || !s->rom[0] ? OW_ERR_SEARCH : OW_ERR_CRC;
+		if(s->status == OW_ERR_CRC) {
+			OW_STAT_INC(crc_errors);
+		}
+		OW_TRACE_EVENT(OW_TRACE_SEARCH, s->status);
+		OwSearchClear(ctx);
+		return 0;
+
+	}
+
+	s->last_discrepancy = last_zero;
+
+	if(!last_zero) {
+		s->last_device = 1;
+	}
+
+	return 1;
+
+}
+
+/**
+ * @fn uint8_t OwSearchFirst(OwContext* ctx)
+ * @brief Restarts the search and finds the first rom on the bus.
+ *
+ * @param ctx		context holding the search state
+ *
+ * @return		0x01 if a rom was found into ctx->search.rom, otherwise 0x00.
+ */
+uint8_t OwSearchFirst(OwContext* ctx) {
+
+	OwSearchClear(ctx);
+
+	return OwSearchPass(ctx, OW_SEARCH_ROM);
+
+}
+
+/**
+ * @fn uint8_t OwSearchNext(OwContext* ctx)
+ * @brief Continues the search from the rom in search state. Search can be resumed later as long as the search state is left untouched.
+ *
+ * @param ctx		context holding the search state
+ *
+ * @return		0x01 if a rom was found into ctx->search.rom, 0x00 when there are no more roms.
+ */
+uint8_t OwSearchNext(OwContext* ctx) {
+
+	return OwSearchPass(ctx, OW_SEARCH_ROM);
+
+}
+
+/**
+ * @fn uint8_t OwSearchRom(OwContext* ctx)
+ * @brief Search roms of all devices connected to the bus. Roms are stored in ascending bit order
+ * using one search pass per device. Interrupt blocking does not apply to this function
+ * above bit level: OW_BLOCK_INTERRUPTS masks the reset and search command of each pass,
+ * the rom bits are masked per slot by OW_BLOCK_INTERRUPTS_BITLEVEL or _SAMPLE.
+ *
+ * @return		number of roms found.
+ */
+uint8_t OwSearchRom(OwContext* ctx) {
+
+	uint8_t found;
+	uint8_t i = 0;
+
+	found = OwSearchFirst(ctx);
+
+	// first pass without conflicts found the only device
+	OW_CTX_SINGLE(ctx, found && ctx->search.last_device);
+
+	while(found && i < OW_CTX_CAPACITY(ctx)) {
+
+		// Rom is stored to static array
+		memcpy(ctx->roms[i], ctx->search.rom, 8);
+		ctx->resolution[i] = 0;
+
+		// no pass for a rom which would not fit
+		if(++i == OW_CTX_CAPACITY(ctx)) {
+			break;
+		}
+
+		found = OwSearchNext(ctx);
+
+	}
+
+	ctx->count = i;
+	OW_ROM_SORT(ctx);
+
+	return i;
+
+}
+
+/**
+ * @fn uint8_t OwReadRom(OwContext* ctx)
+ * @brief Reads the rom of the only device on the bus with Read rom and stores it into the context. Much faster than a search on single device buses. Several devices answering at once corrupt the crc and the rom is rejected.
+ *
+ * @param ctx		context for the rom
+ *
+ * @return		number of roms stored, 0x01 or 0x00
+ */
+uint8_t OwReadRom(OwContext* ctx) {
+
+	uint8_t i;
+	uint8_t* rom = ctx->roms[0];
+
+	OW_SELECT_CTX(ctx);
+
+	ctx->count = 0;
+	OW_CTX_SINGLE(ctx, 0);
+
+	if(!OwReset()) {
+		return 0;
+	}
+
+	OwWriteByte(OW_READ_ROM);
+
+	for(i = 0; i < 8; i++) {
+		rom[i] = OwReadByte();
+	}
+
+	// all ones from an empty bus also fail the crc
+	if(OwCrc8(rom, 8) || !rom[0]) {
+		return 0;
+	}
+
+	ctx->resolution[0] = 0;
+	ctx->count = 1;
+	// crc fails when several devices answer
+	OW_CTX_SINGLE(ctx, 1);
+	OW_ROM_SORT(ctx);
+
+	return 1;
+
+}
+
+/**
+ * @fn uint8_t OwAlarmSearchFirst(OwContext* ctx)
+ * @brief Restarts a conditional search and finds the first rom with alarm flag set.
+ *
+ * @param ctx		context holding the search state
+ *
+ * @return		0x01 if a rom was found into ctx->search.rom, otherwise 0x00.
+ */
+uint8_t OwAlarmSearchFirst(OwContext* ctx) {
+
+	OwSearchClear(ctx);
+
+	return OwSearchPass(ctx, OW_ALARM_SEARCH);
+
+}
+
+/**
+ * @fn uint8_t OwAlarmSearchNext(OwContext* ctx)
+ * @brief Continues a conditional search from the rom in search state.
+ *
+ * @param ctx		context holding the search state
+ *
+ * @return		0x01 if a rom was found into ctx->search.rom, 0x00 when there are no more roms.
+ */
+uint8_t OwAlarmSearchNext(OwContext* ctx) {
+
+	return OwSearchPass(ctx, OW_ALARM_SEARCH);
+
+}
+
+/**
+ * @fn uint8_t OwRomIndex(OwContext* ctx, const uint8_t* rom)
+ * @brief Finds the index of a rom stored by OwSearchRom().
+ *
+ * @param ctx		context holding the roms
+ * @param rom		8-byte rom to look for
+ *
+ * @return		index of the rom or OW_ROM_NOT_FOUND
+ */
+uint8_t OwRomIndex(OwContext* ctx, const uint8_t* rom) {
+
+	return OwRomFind(ctx, rom, 8);
+
+}
+
+/**
+ * @fn uint8_t OwAlarmSearch(OwContext* ctx, uint8_t* indices, uint8_t max)
+ * @brief Finds devices with alarm flag set using Alarm search. Only devices in alarm state take part so the search costs one pass per alarming device. Roms are reported as indices to the roms stored by OwSearchRom(), alarming devices missing from context are skipped. Interrupt blocking does not apply to this function above bit level.
+ *
+ * @param ctx		context holding the roms
+ * @param indices	array for indices of alarming roms
+ * @param max		size of indices array
+ *
+ * @return		number of indices stored.
+ */
+uint8_t OwAlarmSearch(OwContext* ctx, uint8_t* indices, uint8_t max) {
+
+	uint8_t found;
+	uint8_t index;
+	uint8_t i = 0;
+
+	found = OwAlarmSearchFirst(ctx);
+
+	while(found && i < max) {
+
+		index = OwRomIndex(ctx, ctx->search.rom);
+
+		if(index != OW_ROM_NOT_FOUND) {
+
+			indices[i] = index;
+
+			if(++i == max) {
+				break;
+			}
+
+		}
+
+		found = OwAlarmSearchNext(ctx);
+
+	}
+
+	return i;
+
+}
+
+/**
+ * @fn uint8_t OwSearchFamilyFirst(OwContext* ctx, uint8_t family)
+ * @brief Finds the first rom with given family code. Search state is preset to the family code so devices of lower families are not walked.
+ *
+ * @param ctx		context holding the search state
+ * @param family	family code, the first byte of rom
+ *
+ * @return		0x01 if a rom was found into ctx->search.rom, otherwise 0x00.
+ */
+uint8_t OwSearchFamilyFirst(OwContext* ctx, uint8_t family) {
+
+	OwSearchState* s = &ctx->search;
+
+	// every conflict before the last bit follows the preset rom
+	memset(s->rom, 0, 8);
+	s->rom[0] = family;
+	s->last_discrepancy = 64;
+	s->last_family_discrepancy = 0;
+	s->last_device = 0;
+
+	return OwSearchFamilyNext(ctx);
+
+}
+
+/**
+ * @fn uint8_t OwSearchFamilyNext(OwContext* ctx)
+ * @brief Continues a family search. Search ends when the next rom would have a different family code.
+ *
+ * @param ctx		context holding the search state
+ *
+ * @return		0x01 if a rom was found into ctx->search.rom, 0x00 when there are no more roms in the family.
+ */
+uint8_t OwSearchFamilyNext(OwContext* ctx) {
+
+	OwSearchState* s = &ctx->search;
+	uint8_t family = s->rom[0];
+
+	if(!OwSearchPass(ctx, OW_SEARCH_ROM)) {
+		return 0;
+	}
+
+	if(s->rom[0] != family) {
+
+		OwSearchClear(ctx);
+		return 0;
+
+	}
+
+	// next branch is inside the family code, no more roms in this family
+	if(s->last_discrepancy < 9) {
+		s->last_device = 1;
+	}
+
+	return 1;
+
+}
+
+/**
+ * @fn uint8_t OwSearchFamily(OwContext* ctx, uint8_t family)
+ * @brief Search roms of devices with given family code. Only roms of the family are stored and the search costs one pass per device of the family. Interrupt blocking does not apply to this function above bit level.
+ *
+ * @param ctx		context for the roms
+ * @param family	family code, the first byte of rom
+ *
+ * @return		number of roms found.
+ */
+uint8_t OwSearchFamily(OwContext* ctx, uint8_t family) {
+
+	uint8_t found;
+	uint8_t i = 0;
+
+	found = OwSearchFamilyFirst(ctx, family);
+
+	while(found && i < OW_CTX_CAPACITY(ctx)) {
+
+		memcpy(ctx->roms[i], ctx->search.rom, 8);
+		ctx->resolution[i] = 0;
+
+		// no pass for a rom which would not fit
+		if(++i == OW_CTX_CAPACITY(ctx)) {
+			break;
+		}
+
+		found = OwSearchFamilyNext(ctx);
+
+	}
+
+	ctx->count = i;
+	OW_CTX_SINGLE(ctx, 0);
+	OW_ROM_SORT(ctx);
+
+	return i;
+
+}
+
+/**
+ * @fn uint8_t OwVerify(OwContext* ctx, const uint8_t* rom)
+ * @brief Checks whether a device is on the bus with a single search pass which follows the given rom. Search state of the context is preserved.
+ *
+ * @param ctx		context holding the search state and bus
+ * @param rom		8-byte rom to look for
+ *
+ * @return		0x01 if the device answered, otherwise 0x00.
+ */
+uint8_t OwVerify(OwContext* ctx, const uint8_t* rom) {
+
+	OwSearchState saved = ctx->search;
+	OwSearchState* s = &ctx->search;
+	uint8_t found;
+
+	// every conflict follows the rom
+	memcpy(s->rom, rom, 8);
+	s->last_discrepancy = 64;
+	s->last_family_discrepancy = 0;
+	s->last_device = 0;
+
+	found = OwSearchPass(ctx, OW_SEARCH_ROM) && !memcmp(s->rom, rom, 8);
+
+	ctx->search = saved;
 
-	return i + 1;								// total amount of roms found equals found differences + 1.
+	return found;
 
 }
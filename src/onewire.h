@@ -7,14 +7,30 @@
  *
  */
 
+#ifndef ONEWIRE_H
+#define ONEWIRE_H
+
+#include <stdint.h>
 #include "conf.h"
 
+// UART backend runs the interrupt-driven engine
+#if defined(OW_UART) && !defined(OW_ASYNC)
+	#define OW_ASYNC
+#endif
+
 /**
  * @def OW_SEARCH_ROM
  *
  * Search rom command, 0xF0
  */
 #define OW_SEARCH_ROM			0xF0
+/**
+ * @def OW_ALARM_SEARCH
+ *
+ * Alarm search command, 0xEC. Only devices with alarm
+ * flag set take part in the search.
+ */
+#define OW_ALARM_SEARCH			0xEC
 /**
  * @def OW_MATCH_ROM
  *
@@ -33,12 +49,42 @@
  * Read Scratchpad command, 0xBE
  */
 #define OW_READ_SCRATCHPAD		0xBE
+/**
+ * @def OW_WRITE_SCRATCHPAD
+ *
+ * Write Scratchpad command, 0x4E
+ */
+#define OW_WRITE_SCRATCHPAD		0x4E
+/**
+ * @def OW_COPY_SCRATCHPAD
+ *
+ * Copy Scratchpad command, 0x48
+ */
+#define OW_COPY_SCRATCHPAD		0x48
+/**
+ * @def OW_READ_ROM
+ *
+ * Read rom command, 0x33
+ */
+#define OW_READ_ROM			0x33
 /**
  * @def OW_SKIP_ROM
  *
  * Skip rom command, 0xCC
  */
 #define OW_SKIP_ROM			0xCC
+/**
+ * @def OW_OVERDRIVE_SKIP_ROM
+ *
+ * Overdrive skip rom command, 0x3C
+ */
+#define OW_OVERDRIVE_SKIP_ROM		0x3C
+/**
+ * @def OW_OVERDRIVE_MATCH_ROM
+ *
+ * Overdrive match rom command, 0x69
+ */
+#define OW_OVERDRIVE_MATCH_ROM		0x69
 
 /**
  * @def OW_RESET_DELAY
@@ -71,16 +117,673 @@
  */
 #define OW_SAMPLE_DELAY			5
 
+/**
+ * @def OW_OD_RESET_DELAY
+ *
+ * Length of reset pulse at overdrive speed. Specified
+ * as 48 us to 80 us.
+ */
+#define OW_OD_RESET_DELAY		70
+/**
+ * @def OW_OD_PRESENCE_DELAY
+ *
+ * Delay from the end of overdrive reset pulse to presence
+ * pulse sampling.
+ */
+#define OW_OD_PRESENCE_DELAY		8
+/**
+ * @def OW_OD_LONG_DELAY
+ *
+ * Longer delay of r/w operations at overdrive speed.
+ */
+#define OW_OD_LONG_DELAY		8
+/**
+ * @def OW_OD_SHORT_DELAY
+ *
+ * Shorter delay of r/w operations at overdrive speed.
+ */
+#define OW_OD_SHORT_DELAY		1
+/**
+ * @def OW_OD_SAMPLE_DELAY
+ *
+ * Sample delay for read operation at overdrive speed.
+ */
+#define OW_OD_SAMPLE_DELAY		1
+
+/**
+ * @def OW_SPEED_STANDARD
+ *
+ * Standard speed timing, about 15 kbit/s.
+ */
+#define OW_SPEED_STANDARD		0
+/**
+ * @def OW_SPEED_OVERDRIVE
+ *
+ * Overdrive speed timing, about 125 kbit/s.
+ */
+#define OW_SPEED_OVERDRIVE		1
+
+/**
+ * @def OW_OK
+ *
+ * Status codes. OW_ERR_NO_PRESENCE: no presence pulse after
+ * reset. OW_ERR_SHORT: bus stays low after release. OW_ERR_CRC:
+ * crc of received bytes does not match. OW_ERR_SEARCH: no device
+ * answered a search bit, the bus changed during the search.
+ */
+#define OW_OK				0x00
+#define OW_ERR_NO_PRESENCE		0x01
+#define OW_ERR_SHORT			0x02
+#define OW_ERR_CRC			0x03
+#define OW_ERR_SEARCH			0x04
+
+/**
+ * @def OW_TXN_CRC8
+ *
+ * Transaction flag: last byte read is CRC8 of the bytes read
+ * before it. Mismatch fails the transaction with OW_ERR_CRC.
+ */
+#define OW_TXN_CRC8			0x01
+
+/**
+ * @def OW_SCRATCHPAD_SIZE
+ *
+ * Scratchpad length of DS18B20 and similar devices including
+ * the crc byte.
+ */
+#define OW_SCRATCHPAD_SIZE		9
+
+/**
+ * @def OW_CONVERT_POLL
+ *
+ * Conversion flag: poll read time slots for done status.
+ */
+#define OW_CONVERT_POLL			0x01
+/**
+ * @def OW_CONVERT_VERIFY
+ *
+ * Conversion flag: read whole scratchpads and check crc.
+ */
+#define OW_CONVERT_VERIFY		0x02
+/**
+ * @def OW_CONVERT_POWER
+ *
+ * Conversion flag: power parasite sensors with the strong
+ * pull-up during conversion. Requires OW_STRONG_PULLUP.
+ */
+#define OW_CONVERT_POWER		0x04
+
+/**
+ * @def OW_CONVERT_IDLE
+ *
+ * Scheduler states: no conversion, conversion running and
+ * results waiting to be read.
+ */
+#define OW_CONVERT_IDLE			0
+#define OW_CONVERT_BUSY			1
+#define OW_CONVERT_READY		2
+
+/**
+ * @def OW_TEMP_INVALID
+ *
+ * Raw temperature of a sensor which could not be read.
+ */
+#define OW_TEMP_INVALID			((int16_t)0x8000)
+
+/**
+ * @def OW_TXN_SKIP_ROM
+ *
+ * Transaction rom index which addresses all devices with
+ * Skip rom command instead of Match rom.
+ */
+#define OW_TXN_SKIP_ROM			0xFF
+
+/**
+ * @def OW_ROM_NOT_FOUND
+ *
+ * Rom index returned when a rom is not stored in context.
+ */
+#define OW_ROM_NOT_FOUND		0xFF
+
+/**
+ * @def OW_DS18B20_FAMILY
+ *
+ * Family codes of the device modules.
+ */
+#define OW_DS18B20_FAMILY		0x28
+#define OW_DS2413_FAMILY		0x3A
+#define OW_DS2431_FAMILY		0x2D
+
+/**
+ * @def OW_DS18B20_CENTI
+ *
+ * Converts raw DS18B20 temperature in 1/16 C to 1/100 C.
+ */
+#define OW_DS18B20_CENTI(raw)		((int16_t)((int32_t)(raw) * 25 / 4))
+
+/**
+ * @def OW_DS2413_PIOA
+ *
+ * DS2413 PIO status bits: pin state and output latch of both
+ * channels. A cleared latch bit turns the output transistor on.
+ */
+#define OW_DS2413_PIOA			0x01
+#define OW_DS2413_LATCHA		0x02
+#define OW_DS2413_PIOB			0x04
+#define OW_DS2413_LATCHB		0x08
+
+/**
+ * @def OW_DS2431_ROW
+ *
+ * DS2431 scratchpad row and memory size including the
+ * protection and control registers.
+ */
+#define OW_DS2431_ROW			8
+#define OW_DS2431_SIZE			0x90
+
+/**
+ * @struct OwSearchStates
+ *
+ * Persistent state of the rom search. Keeping the state allows
+ * resuming the search with OwSearchNext().
+ */
+typedef struct OwSearchStates {
+	uint8_t rom[8];			// last rom found
+	uint8_t last_discrepancy;	// bit of the last conflict where zero was selected
+	uint8_t last_family_discrepancy;	// same within the family code
+	uint8_t last_device;		// set after the last rom was found
+	uint8_t status;			// OW_OK or OW_ERR_* of the last pass
+} OwSearchState;
+
+#ifdef OW_STATS
+
+/**
+ * @struct OwStatss
+ *
+ * Instrumentation counters.
+ */
+typedef struct OwStatss {
+	uint16_t resets;
+	uint32_t slots;
+	uint16_t bytes;
+	uint16_t retries;		// repeated transactions
+	uint16_t crc_errors;		// search, scratchpad and transaction crc failures
+	uint16_t search_passes;
+	uint32_t busy_ticks;		// bus busy time in OW_STATS_CLOCK() ticks
+} OwStats;
+
+#endif
+
+#ifdef OW_TRACE
+
+/**
+ * @def OW_TRACE_RESET
+ *
+ * Trace events: reset with presence as data, finished
+ * transaction with status as data and failed search pass
+ * with status as data.
+ */
+#define OW_TRACE_RESET			0
+#define OW_TRACE_TXN			1
+#define OW_TRACE_SEARCH			2
+
+/**
+ * @struct OwTraceEntries
+ *
+ * Trace ring buffer entry.
+ */
+typedef struct OwTraceEntries {
+	uint16_t time;			// OW_STATS_CLOCK() at the event
+	uint8_t event;			// OW_TRACE_*
+	uint8_t data;
+} OwTraceEntry;
+
+#endif
+
+#ifdef OW_EDGE
+
+/**
+ * @struct OwEdgeEvents
+ *
+ * Low pulse driven by a slave on an idle bus.
+ */
+typedef struct OwEdgeEvents {
+	uint16_t time;			// OW_STATS_CLOCK() at the falling edge
+	uint16_t width;			// low time in OW_STATS_CLOCK() ticks
+} OwEdgeEvent;
+
+/**
+ * @typedef OwEdgeCallback
+ *
+ * Called from the pin change interrupt at the end of each low pulse.
+ */
+typedef void (*OwEdgeCallback)(const OwEdgeEvent* event);
+
+#endif
+
+#ifdef OW_BENCH
+
+/**
+ * @def OW_BENCH_RESET
+ *
+ * Benchmarked operations, indices of the results of OwBenchRun().
+ */
+#define OW_BENCH_RESET			0
+#define OW_BENCH_READ_BYTE		1
+#define OW_BENCH_WRITE_BYTE		2
+#define OW_BENCH_WRITE_BYTE_TO		3
+#define OW_BENCH_SEARCH_ROM		4
+#define OW_BENCH_COUNT			5
+
+/**
+ * @def OW_BENCH_MODE
+ *
+ * Interrupt blocking of the build, 0x01 for
+ * OW_BLOCK_INTERRUPTS_BITLEVEL, 0x02 for OW_BLOCK_INTERRUPTS and
+ * 0x04 for OW_BLOCK_INTERRUPTS_SAMPLE. Each mode is measured
+ * with its own build.
+ */
+#if defined(OW_BLOCK_INTERRUPTS_SAMPLE)
+	#define OW_BENCH_MODE		0x04
+#elif defined(OW_BLOCK_INTERRUPTS) && defined(OW_BLOCK_INTERRUPTS_BITLEVEL)
+	#define OW_BENCH_MODE		0x03
+#elif defined(OW_BLOCK_INTERRUPTS)
+	#define OW_BENCH_MODE		0x02
+#elif defined(OW_BLOCK_INTERRUPTS_BITLEVEL)
+	#define OW_BENCH_MODE		0x01
+#else
+	#define OW_BENCH_MODE		0x00
+#endif
+
+/**
+ * @def OW_BENCH_US
+ *
+ * Converts benchmark ticks to microseconds.
+ */
+#define OW_BENCH_US(ticks)		((uint32_t)(ticks) * OW_BENCH_PRESCALER / (F_CPU / 1000000UL))
+
+/**
+ * @struct OwBenchResults
+ *
+ * Worst case cost of an operation in Timer1 ticks.
+ */
+typedef struct OwBenchResults {
+	uint32_t cpu;			// time the call blocked the caller
+	uint32_t bus;			// from the call to the last rising edge of the bus
+	uint16_t masked;		// longest delay of the interrupt probe
+} OwBenchResult;
+
+#endif
+
+#ifdef OW_CALIBRATION
+
+/**
+ * @struct OwTimings
+ *
+ * Standard speed slot timing of a bus measured by OwCalibrate().
+ * Delays are in _delay_loop_2() counts of four cycles.
+ */
+typedef struct OwTimings {
+	uint16_t sample;		// release to read sample
+	uint16_t read_tail;		// read sample to the next slot
+	uint16_t zero_tail;		// release of zero bit to the next slot
+	uint16_t one_tail;		// release of one bit to the next slot
+	uint16_t presence;		// release of reset to presence sample
+	uint16_t reset_tail;		// presence sample to the next slot
+	uint8_t rise;			// measured rise time in us, 0 if not calibrated
+} OwTiming;
+
+#endif
+
+#ifdef OW_MULTI_BUS
+
+/**
+ * @struct OwBuses
+ *
+ * I/O pin of a bus. Replaces OW_PORT, OW_PIN, OW_DIRECTION
+ * and OW_BIT when OW_MULTI_BUS is defined.
+ */
+typedef struct OwBuses {
+	volatile uint8_t* port;
+	volatile uint8_t* pin;
+	volatile uint8_t* direction;
+	uint8_t mask;			// bit mask of the pin
+	uint8_t speed;			// OW_SPEED_STANDARD or OW_SPEED_OVERDRIVE
+	#ifdef OW_CALIBRATION
+		OwTiming timing;	// set by OwInitBus() and OwCalibrate()
+	#endif
+} OwBus;
+
+/**
+ * @def OW_BUS
+ *
+ * Initializer for OwBus, e.g. OwBus bus = OW_BUS(PORTC, PINC, DDRC, 5);
+ */
+#define OW_BUS(port, pin, direction, bit)	{ &(port), &(pin), &(direction), 1 << (bit), OW_SPEED_STANDARD }
+
+#endif
+
+#ifdef OW_PARALLEL
+
+/**
+ * @struct OwParallelBuses
+ *
+ * Several buses on pins of the same port driven by the parallel
+ * slot engine.
+ */
+typedef struct OwParallelBuses {
+	volatile uint8_t* port;
+	volatile uint8_t* pin;
+	volatile uint8_t* direction;
+	uint8_t mask;			// pins of the buses
+} OwParallelBus;
+
+/**
+ * @def OW_PARALLEL_BUS
+ *
+ * Initializer for OwParallelBus, e.g. OW_PARALLEL_BUS(PORTC, PINC, DDRC, 0x0F);
+ */
+#define OW_PARALLEL_BUS(port, pin, direction, mask)	{ &(port), &(pin), &(direction), (mask) }
+
+#endif
+
 typedef struct OwContexts {
-	uint8_t roms[OW_MAX_ROMS][8];
+	#ifdef OW_MULTI_BUS
+		OwBus* bus;		// bus the roms were found on
+	#endif
+	#ifdef OW_CONTEXT_BUFFER
+		uint8_t (*roms)[8];	// roms in the buffer of OwContextInit()
+		uint8_t* resolution;	// resolutions after the roms
+		#ifdef OW_ROM_INDEX
+			uint8_t* order;		// sorted slots after the resolutions
+		#endif
+		uint8_t capacity;	// number of roms fitting in the buffer
+	#else
+		uint8_t roms[OW_MAX_ROMS][8];
+		uint8_t resolution[OW_MAX_ROMS];	// DS18B20 resolution in bits, 0 for power-on default
+		#ifdef OW_ROM_INDEX
+			uint8_t order[OW_MAX_ROMS];	// slots sorted by rom in search order
+		#endif
+	#endif
+	uint8_t count;			// number of roms stored by OwSearchRom()
+	#ifdef OW_SKIP_SINGLE_ROM
+		uint8_t single;		// bus is known to hold only the stored rom
+	#endif
+	OwSearchState search;
 } OwContext;
 
+/**
+ * @def OW_CONTEXT_BUFFER_SIZE
+ *
+ * Bytes of context buffer needed for given number of roms.
+ */
+#ifdef OW_ROM_INDEX
+	#define OW_CONTEXT_BUFFER_SIZE(roms)	((roms) * 10)
+#else
+	#define OW_CONTEXT_BUFFER_SIZE(roms)	((roms) * 9)
+#endif
+
+/**
+ * @struct OwPackedTables
+ *
+ * Roms of a single family packed into 6-byte serials. Family
+ * code is stored once and crc is recomputed when a rom is
+ * unpacked with OwPackedRom().
+ */
+typedef struct OwPackedTables {
+	uint8_t family;			// family code of every rom
+	uint8_t (*serials)[6];		// serial numbers, caller buffer
+	uint8_t capacity;		// number of serials fitting in the buffer
+	uint8_t count;			// number of serials stored
+} OwPackedTable;
+
+/**
+ * @struct OwScanStates
+ *
+ * State of a rescan spread over several steps. A whole rescan
+ * costs one search pass per present device, the same as
+ * OwSearchRom().
+ */
+typedef struct OwScanStates {
+	uint8_t seen[(OW_MAX_ROMS + 7) / 8];	// slots found during the rescan
+	uint8_t changes;		// devices added or removed
+	uint8_t active;			// rescan in progress
+} OwScanState;
+
+/**
+ * @typedef OwChangeCallback
+ *
+ * Called by the rescan for each added or removed device with
+ * its slot. Roms of removed devices are still in the context
+ * during the call.
+ */
+typedef void (*OwChangeCallback)(OwContext* ctx, uint8_t rom, uint8_t added);
+
+/**
+ * @struct OwConverts
+ *
+ * Conversion scheduler state.
+ */
+typedef struct OwConverts {
+	OwContext* ctx;			// sensors
+	uint16_t start;			// tick of Convert T
+	uint16_t wait;			// conversion time of the slowest sensor in ms
+	uint8_t pending[(OW_MAX_ROMS + 7) / 8];	// sensors not read yet
+	uint8_t read;			// sensors read since Convert T
+	uint8_t flags;			// OW_CONVERT_POLL, OW_CONVERT_VERIFY and OW_CONVERT_POWER
+	uint8_t state;			// OW_CONVERT_IDLE, OW_CONVERT_BUSY or OW_CONVERT_READY
+} OwConvert;
+
+/**
+ * @struct OwTransactions
+ *
+ * Reset, rom selection, written bytes and read bytes bundled into
+ * one descriptor. Arrays of transactions are executed back-to-back
+ * by OwTransact() or OwAsyncTransact().
+ */
+typedef struct OwTransactions {
+	uint8_t rom;			// index of the rom in context or OW_TXN_SKIP_ROM
+	const uint8_t* write;		// bytes written after rom selection
+	uint8_t write_len;
+	uint8_t* read;			// buffer for bytes read after writing
+	uint8_t read_len;
+	uint8_t speed;			// OW_SPEED_STANDARD or OW_SPEED_OVERDRIVE
+	uint8_t presence;		// set to 0x01 if presence pulse was detected
+	uint8_t flags;			// OW_TXN_CRC8
+	uint8_t status;			// OW_OK or OW_ERR_* of the last attempt
+} OwTransaction;
+
 void OwInit(void);
+
+#ifdef OW_MULTI_BUS
+void OwInitBus(OwBus* bus);
+void OwSelectBus(OwBus* bus);
+#endif
 uint8_t OwReset(void);
+uint8_t OwResetStatus(void);
 
 uint8_t OwReadByte(void);
 
 void OwWriteByte(uint8_t data);
 void OwWriteByteTo(OwContext* ctx, uint8_t rom, uint8_t data);
+void OwWriteByteToRom(const uint8_t* rom, uint8_t data);
+
+#ifdef OW_CONTEXT_BUFFER
+
+void OwContextInit(OwContext* ctx, uint8_t* buf, uint8_t capacity);
+
+#endif
+
+void OwPackedInit(OwPackedTable* table, uint8_t family, uint8_t (*serials)[6], uint8_t capacity);
+uint8_t OwPackedSearch(OwContext* ctx, OwPackedTable* table);
+void OwPackedRom(const OwPackedTable* table, uint8_t index, uint8_t* rom);
+uint8_t OwPackedIndex(const OwPackedTable* table, const uint8_t* rom);
+
+/**
+ * @typedef OwBlockCallback
+ *
+ * Called by block functions after each byte with its position
+ * and value. Returning 0x00 stops the transfer.
+ */
+typedef uint8_t (*OwBlockCallback)(uint8_t pos, uint8_t data);
+
+uint8_t OwReadBlock(uint8_t* buf, uint8_t len);
+uint8_t OwReadBlockUntil(uint8_t* buf, uint8_t len, OwBlockCallback cont);
+uint8_t OwReadStream(uint8_t len, OwBlockCallback cont);
+uint8_t OwWriteBlock(const uint8_t* buf, uint8_t len);
+uint8_t OwWriteBlockUntil(const uint8_t* buf, uint8_t len, OwBlockCallback cont);
+
+uint8_t OwCommand(OwContext* ctx, uint8_t rom, uint8_t command);
+uint8_t OwReadScratchpad(OwContext* ctx, uint8_t rom, uint8_t* buf, uint8_t len, uint8_t verify);
+uint8_t OwReadScratchpadStatus(OwContext* ctx, uint8_t rom, uint8_t* buf, uint8_t len, uint8_t verify);
+
+uint8_t OwDs18b20Read(OwContext* ctx, uint8_t rom, int16_t* temp, uint8_t verify);
+uint8_t OwDs18b20Parasite(OwContext* ctx, uint8_t rom, uint8_t* parasite);
+uint8_t OwDs2413Read(OwContext* ctx, uint8_t rom, uint8_t* state);
+uint8_t OwDs2413Write(OwContext* ctx, uint8_t rom, uint8_t latches);
+uint8_t OwDs2431Read(OwContext* ctx, uint8_t rom, uint8_t address, uint8_t len, OwBlockCallback data);
+uint8_t OwDs2431WriteRow(OwContext* ctx, uint8_t rom, uint8_t address, const uint8_t* data);
 
 uint8_t OwSearchRom(OwContext* ctx);
+uint8_t OwReadRom(OwContext* ctx);
+uint8_t OwSearchFirst(OwContext* ctx);
+uint8_t OwSearchNext(OwContext* ctx);
+
+uint8_t OwAlarmSearch(OwContext* ctx, uint8_t* indices, uint8_t max);
+uint8_t OwAlarmSearchFirst(OwContext* ctx);
+uint8_t OwAlarmSearchNext(OwContext* ctx);
+
+uint8_t OwSearchFamily(OwContext* ctx, uint8_t family);
+uint8_t OwSearchFamilyFirst(OwContext* ctx, uint8_t family);
+uint8_t OwSearchFamilyNext(OwContext* ctx);
+
+uint8_t OwRomIndex(OwContext* ctx, const uint8_t* rom);
+uint8_t OwRomFind(OwContext* ctx, const uint8_t* prefix, uint8_t len);
+uint8_t OwVerify(OwContext* ctx, const uint8_t* rom);
+
+uint8_t OwRescanStep(OwContext* ctx, OwScanState* scan, OwChangeCallback changed);
+uint8_t OwRescan(OwContext* ctx, OwScanState* scan, OwChangeCallback changed);
+
+#ifdef OW_ROM_CACHE
+
+void OwCacheStore(OwContext* ctx);
+uint8_t OwCacheLoad(OwContext* ctx);
+uint8_t OwCacheStartup(OwContext* ctx);
+
+#endif
+
+#ifdef OW_OVERDRIVE
+
+void OwSetSpeed(uint8_t speed);
+uint8_t OwGetSpeed(void);
+
+void OwOverdriveSkipRom(void);
+void OwOverdriveMatchRom(OwContext* ctx, uint8_t rom);
+
+#endif
+
+#ifdef OW_PARALLEL
+
+void OwParallelInit(const OwParallelBus* bus);
+uint8_t OwParallelReset(const OwParallelBus* bus);
+void OwParallelWriteByte(const OwParallelBus* bus, const uint8_t* data);
+void OwParallelWriteByteAll(const OwParallelBus* bus, uint8_t data);
+void OwParallelReadByte(const OwParallelBus* bus, uint8_t* data);
+
+#endif
+
+uint8_t OwTransact(OwContext* ctx, OwTransaction* txn, uint8_t count);
+
+#ifdef OW_STATS
+
+void OwStatsRead(OwStats* stats);
+void OwStatsClear(void);
+
+#endif
+
+#ifdef OW_TRACE
+
+uint8_t OwTraceRead(OwTraceEntry* entries, uint8_t max);
+
+#endif
+
+#ifdef OW_EDGE
+
+void OwEdgeArm(OwEdgeCallback callback);
+void OwEdgeDisarm(void);
+uint8_t OwEdgeRead(OwEdgeEvent* event);
+
+#endif
+
+#ifdef OW_BENCH
+
+void OwBenchInit(void);
+void OwBenchRun(OwContext* ctx, OwBenchResult* results);
+
+#endif
+
+#ifdef OW_CALIBRATION
+
+uint8_t OwCalibrate(void);
+void OwTimingDefaults(void);
+
+#endif
+
+#ifdef OW_STRONG_PULLUP
+
+void OwWriteBytePower(uint8_t data, uint16_t ms);
+uint8_t OwPowerActive(void);
+void OwPowerRelease(void);
+
+#endif
+
+uint16_t OwConvertTime(uint8_t resolution);
+uint8_t OwSetResolution(OwContext* ctx, uint8_t rom, uint8_t resolution);
+void OwConvertInit(OwConvert* conv, OwContext* ctx, uint8_t flags);
+uint8_t OwConvertStart(OwConvert* conv, uint16_t now);
+uint8_t OwConvertUpdate(OwConvert* conv, uint16_t now);
+uint8_t OwConvertRead(OwConvert* conv, int16_t* temps, uint16_t now);
+
+#ifdef OW_SLEEP
+
+uint16_t OwSleep(uint16_t ms);
+uint16_t OwConvertSleep(OwConvert* conv, uint16_t now);
+
+#endif
+
+uint8_t OwCrc8Update(uint8_t crc, uint8_t data);
+uint16_t OwCrc16Update(uint16_t crc, uint8_t data);
+uint8_t OwCrc8(const uint8_t* data, uint8_t len);
+uint16_t OwCrc16(const uint8_t* data, uint16_t len);
+
+#ifdef OW_CRC_STREAM
+
+void OwCrcStart(void);
+uint8_t OwCrc8Result(void);
+uint16_t OwCrc16Result(void);
+
+#endif
+
+#ifdef OW_ASYNC
+
+/**
+ * @typedef OwAsyncCallback
+ *
+ * Completion callback of the timer-driven engine. Called from
+ * the timer interrupt with the result of the finished operation.
+ */
+typedef void (*OwAsyncCallback)(uint8_t result);
+
+void OwAsyncInit(void);
+
+void OwAsyncReset(OwAsyncCallback done);
+void OwAsyncReadByte(OwAsyncCallback done);
+void OwAsyncWriteByte(uint8_t data, OwAsyncCallback done);
+void OwAsyncTransact(OwContext* ctx, OwTransaction* txn, uint8_t count, OwAsyncCallback done);
+
+uint8_t OwAsyncBusy(void);
+uint8_t OwAsyncWait(void);
+
+#endif
+
+#endif
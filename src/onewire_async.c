@@ -0,0 +1,497 @@
+/**
+ * @file onewire_async.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Interrupt-driven 1-Wire engine. The front end keeps the state of the
+ * current operation, chains transaction queues and signals completion.
+ * Operations are executed by a backend: by default reset and bit slots
+ * are sequenced from the Timer1 compare match interrupt running in CTC
+ * mode, with OW_UART the USART in onewire_uart.c is used instead.
+ *
+ * Only the time-critical start of a timer slot (low pulse and sampling)
+ * is spent inside the interrupt, the long low phase of a zero bit,
+ * recovery and the reset windows are left to the timer.
+ */
+
+#include "onewire_bus.h"
+
+#ifdef OW_ASYNC
+
+volatile OwAsyncState ow_async;
+
+static OwTxnCursor ow_async_txn;	// position in the transaction queue
+
+/**
+ * @fn static inline void OwAsyncLoad(uint8_t op, uint8_t data, uint8_t bits)
+ * @brief Loads an operation into the engine state.
+ *
+ * @param op		OW_OP_RESET, OW_OP_READ or OW_OP_WRITE
+ * @param data		bits to write LSB first
+ * @param bits		number of slots, 1 to 8
+ */
+static inline void OwAsyncLoad(uint8_t op, uint8_t data, uint8_t bits) {
+
+	ow_async.op = op;
+	ow_async.data = op == OW_OP_READ ? 0 : data;
+	ow_async.mask = 1;
+	ow_async.bits = bits;
+
+}
+
+/**
+ * @fn void OwAsyncInit(void)
+ * @brief Initializes the backend. Called by OwInit().
+ */
+void OwAsyncInit(void) {
+
+	ow_async.busy = 0;
+
+	OwBackendInit();
+
+}
+
+/**
+ * @fn void OwAsyncStart(uint8_t op, uint8_t data, uint8_t bits, OwAsyncCallback done)
+ * @brief Starts an engine operation. Waits for the previous operation to finish first.
+ *
+ * @param op		OW_OP_RESET, OW_OP_READ or OW_OP_WRITE
+ * @param data		bits to write LSB first
+ * @param bits		number of slots, 1 to 8
+ * @param done		completion callback or 0
+ */
+void OwAsyncStart(uint8_t op, uint8_t data, uint8_t bits, OwAsyncCallback done) {
+
+	while(ow_async.busy);
+
+	ow_async.txn = 0;
+	OwAsyncLoad(op, data, bits);
+
+	ow_async.done = done;
+	ow_async.busy = 1;
+	OwBackendKick();
+
+}
+
+/**
+ * @fn void OwAsyncTransact(OwContext* ctx, OwTransaction* txn, uint8_t count, OwAsyncCallback done)
+ * @brief Starts executing a queue of transactions. Operations are chained inside the interrupt without gaps. Result is the number of transactions which got a presence pulse.
+ *
+ * @param ctx		context holding the roms
+ * @param txn		array of transactions, has to stay valid until completion
+ * @param count		number of transactions
+ * @param done		completion callback or 0
+ */
+void OwAsyncTransact(OwContext* ctx, OwTransaction* txn, uint8_t count, OwAsyncCallback done) {
+
+	uint8_t op;
+	uint8_t data = 0;
+
+	while(ow_async.busy);
+
+	OW_SELECT_CTX(ctx);
+
+	ow_async_txn.ctx = ctx;
+	ow_async_txn.txn = txn;
+	ow_async_txn.count = count;
+	ow_async_txn.stage = OW_TXN_STAGE_RESET;
+	ow_async_txn.pos = 0;
+	ow_async_txn.found = 0;
+	ow_async_txn.crc = 0;
+	ow_async_txn.retry = 0;
+	ow_async_txn.backoff = 0;
+
+	op = OwTxnNext(&ow_async_txn, &data);
+
+	if(op == OW_OP_DONE) {
+
+		// empty queue completes right away
+		ow_async.result = 0;
+		if(done) {
+			done(0);
+		}
+		return;
+
+	}
+
+	ow_async.txn = 1;
+	OwAsyncLoad(op, data, 8);
+
+	ow_async.done = done;
+	ow_async.busy = 1;
+	OwBackendKick();
+
+}
+
+/**
+ * @fn uint8_t OwAsyncOpDone(void)
+ * @brief Called by the backend from its interrupt when the loaded operation has finished. Loads the next operation of a transaction queue or completes the engine operation.
+ *
+ * @return 0x01 if the next operation was loaded and has to be started right away, 0x00 if the engine stopped.
+ */
+uint8_t OwAsyncOpDone(void) {
+
+	OwAsyncCallback done;
+	uint8_t op;
+	uint8_t data = 0;
+
+	if(ow_async.op != OW_OP_RESET) {
+		ow_async.result = ow_async.data;
+	}
+
+	if(ow_async.txn) {
+
+		OwTxnResult(&ow_async_txn, ow_async.result);
+		op = OwTxnNext(&ow_async_txn, &data);
+
+		if(op != OW_OP_DONE) {
+
+			OwAsyncLoad(op, data, 8);
+			return 1;
+
+		}
+
+		ow_async.result = ow_async_txn.found;
+
+	}
+
+	OwBackendStop();
+
+	done = ow_async.done;
+	ow_async.busy = 0;
+
+	// callback may start the next operation
+	if(done) {
+		done(ow_async.result);
+	}
+
+	return 0;
+
+}
+
+/**
+ * @fn void OwAsyncReset(OwAsyncCallback done)
+ * @brief Starts a reset pulse. Result is 0x01 if presence pulse was detected.
+ *
+ * @param done		completion callback or 0
+ */
+void OwAsyncReset(OwAsyncCallback done) {
+
+	OwAsyncStart(OW_OP_RESET, 0, 0, done);
+
+}
+
+/**
+ * @fn void OwAsyncReadByte(OwAsyncCallback done)
+ * @brief Starts reading a byte. Result is the byte read.
+ *
+ * @param done		completion callback or 0
+ */
+void OwAsyncReadByte(OwAsyncCallback done) {
+
+	OwAsyncStart(OW_OP_READ, 0, 8, done);
+
+}
+
+/**
+ * @fn void OwAsyncWriteByte(uint8_t data, OwAsyncCallback done)
+ * @brief Starts writing a byte.
+ *
+ * @param data		byte to be written to the bus
+ * @param done		completion callback or 0
+ */
+void OwAsyncWriteByte(uint8_t data, OwAsyncCallback done) {
+
+	OwAsyncStart(OW_OP_WRITE, data, 8, done);
+
+}
+
+/**
+ * @fn uint8_t OwAsyncBusy(void)
+ * @brief Completion flag of the engine.
+ *
+ * @return 0x01 while an operation is in progress, otherwise 0x00.
+ */
+uint8_t OwAsyncBusy(void) {
+
+	return ow_async.busy;
+
+}
+
+/**
+ * @fn uint8_t OwAsyncWait(void)
+ * @brief Waits for the current operation to finish. Interrupts have to be enabled. With OW_SLEEP the MCU sleeps in idle mode between the interrupts of the engine.
+ *
+ * @return result of the last operation
+ */
+uint8_t OwAsyncWait(void) {
+
+	#ifdef OW_SLEEP
+
+		// engine interrupts wake the MCU
+		for(;;) {
+
+			cli();
+
+			if(!ow_async.busy) {
+				sei();
+				break;
+			}
+
+			OwSleepIdle();
+
+		}
+
+	#else
+
+		while(ow_async.busy);
+
+	#endif
+
+	return ow_async.result;
+
+}
+
+/**
+ * @fn uint8_t OwAsyncNextBit(void)
+ * @brief Advances to the next bit of the loaded operation.
+ *
+ * @return 0x01 if bits are left, otherwise 0x00.
+ */
+uint8_t OwAsyncNextBit(void) {
+
+	ow_async.mask <<= 1;
+
+	return --ow_async.bits != 0;
+
+}
+
+#ifndef OW_UART
+
+#if OW_ASYNC_PRESCALER == 1
+	#define OW_ASYNC_CS		(1 << CS10)
+#elif OW_ASYNC_PRESCALER == 8
+	#define OW_ASYNC_CS		(1 << CS11)
+#elif OW_ASYNC_PRESCALER == 64
+	#define OW_ASYNC_CS		((1 << CS11) | (1 << CS10))
+#else
+	#error "OW_ASYNC_PRESCALER must be 1, 8 or 64"
+#endif
+
+/**
+ * @def OW_ASYNC_TICKS
+ *
+ * Converts microseconds to Timer1 compare value. CTC period is OCR1A + 1.
+ */
+#define OW_ASYNC_TICKS(us)		((uint16_t)((F_CPU / 1000UL) * (us) / (OW_ASYNC_PRESCALER * 1000UL)) - 1)
+
+#if (F_CPU / 1000UL) * OW_RESET_DELAY / (OW_ASYNC_PRESCALER * 1000UL) > 0xFFFF
+	#error "Reset pulse does not fit in Timer1 with OW_ASYNC_PRESCALER"
+#endif
+
+// timer backend phases
+#define OW_PHASE_RESET			0	// drive reset pulse
+#define OW_PHASE_RESET_RELEASE		1	// release bus after reset pulse
+#define OW_PHASE_PRESENCE		2	// sample presence pulse
+#define OW_PHASE_SLOT			3	// start a read or write slot
+#define OW_PHASE_RELEASE		4	// release bus after a zero bit
+#define OW_PHASE_DONE			5	// operation finished
+
+/**
+ * @def OW_ASYNC_MARGIN
+ *
+ * Timer ticks needed to write the compare value, about 16 CPU
+ * cycles.
+ */
+#define OW_ASYNC_MARGIN			(16 / OW_ASYNC_PRESCALER + 1)
+
+/**
+ * @fn static inline void OwAsyncSchedule(uint16_t ticks)
+ * @brief Sets the time from the previous compare match to the next one. OCR1A is not double-buffered in CTC mode, so a compare value the counter has already passed would only match after a wrap through 0xFFFF. Such short delays are stretched to end right after the write.
+ *
+ * @param ticks		compare value from OW_ASYNC_TICKS()
+ */
+static inline void OwAsyncSchedule(uint16_t ticks) {
+
+	uint16_t now = TCNT1 + OW_ASYNC_MARGIN;
+
+	// interrupt entry may have taken longer than the delay
+	OCR1A = ticks > now ? ticks : now;
+
+}
+
+/**
+ * @fn static inline void OwAsyncFirstPhase(void)
+ * @brief Selects the first phase of the loaded operation.
+ */
+static inline void OwAsyncFirstPhase(void) {
+
+	ow_async.phase = ow_async.op == OW_OP_RESET ? OW_PHASE_RESET : OW_PHASE_SLOT;
+
+}
+
+/**
+ * @fn static inline void OwAsyncBitDone(void)
+ * @brief Advances to the next bit and selects the following phase.
+ */
+static inline void OwAsyncBitDone(void) {
+
+	ow_async.phase = OwAsyncNextBit() ? OW_PHASE_SLOT : OW_PHASE_DONE;
+
+}
+
+/**
+ * @fn void OwBackendInit(void)
+ * @brief Initializes Timer1 for the engine. Timer is kept stopped while the engine is idle.
+ */
+void OwBackendInit(void) {
+
+	TIMSK1 &= ~(1 << OCIE1A);
+	TCCR1A = 0;
+	TCCR1B = 1 << WGM12;
+
+}
+
+/**
+ * @fn void OwBackendKick(void)
+ * @brief Starts the timer for a loaded operation. First step is run a few timer ticks later.
+ */
+void OwBackendKick(void) {
+
+	OwAsyncFirstPhase();
+
+	TCNT1 = 0;
+	OwAsyncSchedule(1);
+	TIFR1 = 1 << OCF1A;
+	TIMSK1 |= 1 << OCIE1A;
+	TCCR1B = (1 << WGM12) | OW_ASYNC_CS;
+
+}
+
+/**
+ * @fn void OwBackendStop(void)
+ * @brief Stops the timer after the last operation.
+ */
+void OwBackendStop(void) {
+
+	TCCR1B = 1 << WGM12;
+	TIMSK1 &= ~(1 << OCIE1A);
+
+}
+
+ISR(TIMER1_COMPA_vect) {
+
+	uint8_t again;
+
+	do {
+
+		again = 0;
+
+		switch(ow_async.phase) {
+
+			case OW_PHASE_RESET:
+
+				OwWriteBusLow();
+				OwAsyncSchedule(OW_IS_OVERDRIVE ? OW_ASYNC_TICKS(OW_OD_RESET_DELAY) : OW_ASYNC_TICKS(OW_RESET_DELAY));
+				ow_async.phase = OW_PHASE_RESET_RELEASE;
+				break;
+
+			case OW_PHASE_RESET_RELEASE:
+
+				OwWriteBusHigh();
+				OwAsyncSchedule(OW_IS_OVERDRIVE ? OW_ASYNC_TICKS(OW_OD_PRESENCE_DELAY) : OW_ASYNC_TICKS(OW_LONG_DELAY));
+				ow_async.phase = OW_PHASE_PRESENCE;
+				break;
+
+			case OW_PHASE_PRESENCE:
+
+				// presence pulse pulls the bus low
+				ow_async.result = OwSampleBus() ^ 0x01;
+				OwAsyncSchedule(OW_IS_OVERDRIVE ? OW_ASYNC_TICKS(OW_OD_RESET_DELAY - OW_OD_PRESENCE_DELAY) : OW_ASYNC_TICKS(OW_RESET_DELAY - OW_LONG_DELAY));
+				ow_async.phase = OW_PHASE_DONE;
+				break;
+
+			case OW_PHASE_SLOT:
+
+				if(OW_IS_OVERDRIVE) {
+
+					// overdrive slots are shorter than the interrupt overhead,
+					// the remaining bits are run from here without the timer
+					if(ow_async.op == OW_OP_READ) {
+
+						if(OwReadSlot(OW_OD_SHORT_DELAY, OW_OD_SAMPLE_DELAY, OW_OD_LONG_DELAY - OW_OD_SAMPLE_DELAY)) {
+							ow_async.data |= ow_async.mask;
+						}
+
+					} else {
+
+						OwWriteSlot((ow_async.data & ow_async.mask) ? 1 : 0, OW_OD_SHORT_DELAY, OW_OD_LONG_DELAY);
+
+					}
+
+					OwAsyncBitDone();
+					again = 1;
+					break;
+
+				}
+
+				if(ow_async.op == OW_OP_WRITE && !(ow_async.data & ow_async.mask)) {
+
+					// zero bit keeps the bus low for the long delay
+					OwWriteBusLow();
+					OwAsyncSchedule(OW_ASYNC_TICKS(OW_LONG_DELAY));
+					ow_async.phase = OW_PHASE_RELEASE;
+					break;
+
+				}
+
+				// one bit and read slot share the short low pulse
+				OwWriteBusLow();
+				OwDelay(OW_SHORT_DELAY, OW_BUS_CYCLES);
+				OwWriteBusHigh();
+
+				if(ow_async.op == OW_OP_READ) {
+
+					OwDelay(OW_SAMPLE_DELAY, OW_SAMPLE_CYCLES);
+
+					if(OwSampleBus()) {
+						ow_async.data |= ow_async.mask;
+					}
+
+				}
+
+				// slot ends after the long delay, counted from the falling edge
+				OwAsyncSchedule(OW_ASYNC_TICKS(OW_SHORT_DELAY + OW_LONG_DELAY));
+				OwAsyncBitDone();
+				break;
+
+			case OW_PHASE_RELEASE:
+
+				OwWriteBusHigh();
+				OwAsyncSchedule(OW_ASYNC_TICKS(OW_SHORT_DELAY));
+				OwAsyncBitDone();
+				break;
+
+			case OW_PHASE_DONE:
+
+				// recovery of the previous slot is over, next operation starts now
+				if(OwAsyncOpDone()) {
+
+					OwAsyncFirstPhase();
+					again = 1;
+
+				}
+
+				break;
+
+		}
+
+	} while(again);
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,221 @@
+/**
+ * @file onewire_bench.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * On-target benchmark of the blocking functions. Timer1 runs free
+ * with a periodic compare interrupt whose latency tells how long
+ * interrupts were masked, and input capture on ICP1 latches the last
+ * rising edge of the bus. ICP1 has to be connected to the bus pin.
+ */
+
+#include "onewire_bus.h"
+
+#ifdef OW_BENCH
+
+#if OW_BENCH_PRESCALER == 1
+	#define OW_BENCH_CS		(1 << CS10)
+#elif OW_BENCH_PRESCALER == 8
+	#define OW_BENCH_CS		(1 << CS11)
+#elif OW_BENCH_PRESCALER == 64
+	#define OW_BENCH_CS		((1 << CS11) | (1 << CS10))
+#else
+	#error "OW_BENCH_PRESCALER must be 1, 8 or 64"
+#endif
+
+static volatile uint16_t ow_bench_high;
+static volatile uint16_t ow_bench_late;
+
+/**
+ * @fn static uint32_t OwBenchNow(void)
+ * @brief Reads Timer1 extended to 32 bits by the overflow interrupt.
+ *
+ * @return		timer ticks
+ */
+static uint32_t OwBenchNow(void) {
+
+	uint8_t sreg = SREG;
+	uint16_t low;
+	uint16_t high;
+
+	cli();
+
+	low = TCNT1;
+	high = ow_bench_high;
+
+	// overflow not yet counted by the interrupt
+	if((TIFR1 & (1 << TOV1)) && low < 0x8000) {
+		high++;
+	}
+
+	SREG = sreg;
+
+	return ((uint32_t)high << 16) | low;
+
+}
+
+/**
+ * @fn static void OwBenchOperation(OwContext* ctx, uint8_t op)
+ * @brief Runs a benchmarked operation.
+ *
+ * @param ctx		context of OW_BENCH_WRITE_BYTE_TO and OW_BENCH_SEARCH_ROM
+ * @param op		OW_BENCH_* operation
+ */
+static void OwBenchOperation(OwContext* ctx, uint8_t op) {
+
+	switch(op) {
+
+		case OW_BENCH_RESET:
+			OwReset();
+			break;
+
+		case OW_BENCH_READ_BYTE:
+			OwReadByte();
+			break;
+
+		case OW_BENCH_WRITE_BYTE:
+			OwWriteByte(OW_SKIP_ROM);
+			break;
+
+		case OW_BENCH_WRITE_BYTE_TO:
+			OwWriteByteTo(ctx, 0, OW_READ_SCRATCHPAD);
+			break;
+
+		case OW_BENCH_SEARCH_ROM:
+			OwSearchRom(ctx);
+			break;
+
+	}
+
+}
+
+/**
+ * @fn static uint16_t OwBenchIdle(void)
+ * @brief Measures the latency of the probe interrupt with nothing masking it.
+ *
+ * @return		latency in timer ticks
+ */
+static uint16_t OwBenchIdle(void) {
+
+	uint32_t start = OwBenchNow();
+
+	ow_bench_late = 0;
+	while(OwBenchNow() - start < 4UL * OW_BENCH_PERIOD);
+
+	return ow_bench_late;
+
+}
+
+/**
+ * @fn void OwBenchInit(void)
+ * @brief Takes Timer1 for the benchmark and enables interrupts.
+ */
+void OwBenchInit(void) {
+
+	TCCR1B = 0;
+	TCCR1A = 0;
+	TCNT1 = 0;
+	ow_bench_high = 0;
+
+	OCR1A = OW_BENCH_PERIOD;
+	TIFR1 = (1 << TOV1) | (1 << OCF1A) | (1 << ICF1);
+	TIMSK1 = (1 << TOIE1) | (1 << OCIE1A);
+
+	// normal mode, input capture on rising edge
+	TCCR1B = (1 << ICES1) | OW_BENCH_CS;
+
+	sei();
+
+}
+
+/**
+ * @fn void OwBenchRun(OwContext* ctx, OwBenchResult* results)
+ * @brief Measures each OW_BENCH_* operation OW_BENCH_REPEAT times and keeps the worst case. OW_BENCH_WRITE_BYTE_TO addresses the first rom of the context, reads and writes are preceded by a reset which is not measured.
+ *
+ * @param ctx		context holding at least one rom
+ * @param results	OW_BENCH_COUNT results
+ */
+void OwBenchRun(OwContext* ctx, OwBenchResult* results) {
+
+	uint8_t op;
+	uint8_t i;
+	uint16_t idle;
+	uint16_t late;
+	uint32_t start;
+	uint32_t end;
+	uint32_t bus;
+	OwBenchResult* result;
+
+	idle = OwBenchIdle();
+
+	for(op = 0; op < OW_BENCH_COUNT; op++) {
+
+		result = &results[op];
+		result->cpu = 0;
+		result->bus = 0;
+		result->masked = 0;
+
+		for(i = 0; i < OW_BENCH_REPEAT; i++) {
+
+			if(op != OW_BENCH_RESET && op != OW_BENCH_SEARCH_ROM) {
+				OwReset();
+			}
+
+			TIFR1 = 1 << ICF1;
+			ow_bench_late = 0;
+
+			start = OwBenchNow();
+			OwBenchOperation(ctx, op);
+			end = OwBenchNow();
+
+			late = ow_bench_late;
+
+			// last rising edge went into ICR1 less than a timer period ago
+			bus = 0;
+			if(TIFR1 & (1 << ICF1)) {
+				bus = end - (uint16_t)((uint16_t)end - ICR1) - start;
+			}
+
+			if(end - start > result->cpu) {
+				result->cpu = end - start;
+			}
+
+			if(bus > result->bus) {
+				result->bus = bus;
+			}
+
+			if(late > idle && late - idle > result->masked) {
+				result->masked = late - idle;
+			}
+
+		}
+
+	}
+
+}
+
+ISR(TIMER1_OVF_vect) {
+
+	ow_bench_high++;
+
+}
+
+ISR(TIMER1_COMPA_vect) {
+
+	uint16_t late = TCNT1 - OCR1A;
+
+	if(late > ow_bench_late) {
+		ow_bench_late = late;
+	}
+
+	// a window longer than the period would skip a whole timer cycle
+	OCR1A += OW_BENCH_PERIOD;
+	if((int16_t)(OCR1A - TCNT1) <= 0) {
+		OCR1A = TCNT1 + OW_BENCH_PERIOD;
+	}
+
+}
+
+#endif
@@ -0,0 +1,714 @@
+/**
+ * @file onewire_bus.h
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Internal bus primitives shared by the library sources. This header
+ * is not part of the public API.
+ */
+
+#ifndef ONEWIRE_BUS_H
+#define ONEWIRE_BUS_H
+
+#include "onewire.h"
+
+#ifdef OW_SIM
+	#include "onewire_sim.h"
+#else
+	#include <avr/io.h>
+	#include <avr/interrupt.h>
+#endif
+
+#if defined(OW_UART) && defined(OW_OVERDRIVE)
+	#error "Overdrive is not supported by the UART backend"
+#endif
+
+#if defined(OW_UART) && defined(OW_MULTI_BUS)
+	#error "UART backend drives a single bus"
+#endif
+
+#if defined(OW_UART) && defined(OW_STRONG_PULLUP)
+	#error "UART backend cannot drive the strong pull-up"
+#endif
+
+#if defined(OW_CALIBRATION) && defined(OW_ASYNC)
+	#error "Calibrated timing is not supported by the timer-driven engine"
+#endif
+
+#if defined(OW_EDGE) && (defined(OW_ASYNC) || defined(OW_UART) || defined(OW_MULTI_BUS) || defined(OW_SIM))
+	#error "Edge capture watches the single pin driven bus"
+#endif
+
+#if defined(OW_SIM) && (defined(OW_ASYNC) || defined(OW_UART) || defined(OW_MULTI_BUS) || defined(OW_PARALLEL))
+	#error "Simulated bus replaces a single pin driven bus"
+#endif
+
+#if defined(OW_SIM) && (defined(OW_SLEEP) || defined(OW_STRONG_PULLUP) || defined(OW_CALIBRATION) || defined(OW_ROM_CACHE) || defined(OW_CRC_TABLE) || defined(OW_CRC_NIBBLE))
+	#error "Feature uses AVR peripherals not present in the simulated bus"
+#endif
+
+#if defined(OW_BENCH) && ((defined(OW_ASYNC) && !defined(OW_UART)) || defined(OW_SIM))
+	#error "Benchmark needs Timer1 of the target"
+#endif
+
+#ifdef OW_ASYNC
+	// The engine times slots from its own interrupt. Masking interrupts
+	// around the blocking wrappers would stall it.
+	#undef OW_BLOCK_INTERRUPTS
+	#undef OW_BLOCK_INTERRUPTS_BITLEVEL
+	#undef OW_BLOCK_INTERRUPTS_SAMPLE
+#endif
+
+#if defined(OW_BLOCK_INTERRUPTS_SAMPLE) && (defined(OW_BLOCK_INTERRUPTS) || defined(OW_BLOCK_INTERRUPTS_BITLEVEL))
+	#error "OW_BLOCK_INTERRUPTS_SAMPLE re-enables interrupts inside the slots"
+#endif
+
+#ifdef OW_MULTI_BUS
+
+	extern OwBus* ow_bus;
+
+	#define OW_BUS_PORT		(*ow_bus->port)
+	#define OW_BUS_PIN		(*ow_bus->pin)
+	#define OW_BUS_DIRECTION	(*ow_bus->direction)
+	#define OW_BUS_MASK		(ow_bus->mask)
+
+	// functions taking a context work on the bus of the context
+	#define OW_SELECT_CTX(ctx)	OwSelectBus((ctx)->bus)
+
+#elif defined(OW_SIM)
+
+	// registers of the simulated bus, pin is evaluated on read
+	#define OW_BUS_PORT		ow_sim_port
+	#define OW_BUS_PIN		OwSimPin()
+	#define OW_BUS_DIRECTION	ow_sim_direction
+	#define OW_BUS_MASK		0x01
+
+	#define OW_SELECT_CTX(ctx)
+
+#else
+
+	// single bus from conf.h, compiles to SBI, CBI and SBIC
+	#define OW_BUS_PORT		OW_PORT
+	#define OW_BUS_PIN		OW_PIN
+	#define OW_BUS_DIRECTION	OW_DIRECTION
+	#define OW_BUS_MASK		(1 << OW_BIT)
+
+	#define OW_SELECT_CTX(ctx)
+
+#endif
+
+#ifdef OW_CONTEXT_BUFFER
+	#define OW_CTX_CAPACITY(ctx)	((ctx)->capacity)
+#else
+	#define OW_CTX_CAPACITY(ctx)	OW_MAX_ROMS
+#endif
+
+#ifdef OW_ROM_INDEX
+
+void OwRomSort(OwContext* ctx);
+
+	// called after roms of the context have changed
+	#define OW_ROM_SORT(ctx)	OwRomSort(ctx)
+
+#else
+
+	#define OW_ROM_SORT(ctx)
+
+#endif
+
+#ifdef OW_SKIP_SINGLE_ROM
+	// only OwReadRom() and a full search can tell the bus holds one device
+	#define OW_CTX_SINGLE(ctx, value)	((ctx)->single = (value))
+#else
+	#define OW_CTX_SINGLE(ctx, value)
+#endif
+
+/**
+ * @fn static inline uint8_t OwSkipSingle(OwContext* ctx)
+ * @brief Checks whether Match rom can be replaced with Skip rom because the context holds the only device of the bus. A single stored rom is not enough, family searches, full contexts and rescans store one rom of a larger bus. Always 0x00 unless OW_SKIP_SINGLE_ROM is defined.
+ *
+ * @param ctx		context holding the roms
+ *
+ * @return		0x01 if Skip rom can be used, otherwise 0x00.
+ */
+static inline uint8_t OwSkipSingle(OwContext* ctx) {
+
+	#ifdef OW_SKIP_SINGLE_ROM
+		return ctx->single && ctx->count == 1;
+	#else
+		(void)ctx;
+		return 0;
+	#endif
+
+}
+
+/**
+ * @fn static inline void OwWriteBusHigh(void)
+ * @brief A static function for writing the bus to high state. Basically just releases the bus. If OW_INTERNAL_PULLUP is defined the internal pull-up resistor is used.
+ */
+static inline void OwWriteBusHigh(void) {
+
+	OW_BUS_DIRECTION &= ~OW_BUS_MASK;
+	#ifdef OW_INTERNAL_PULLUP
+		OW_BUS_PORT |= OW_BUS_MASK;
+	#endif
+
+}
+
+/**
+ * @fn static inline void OwWriteBusLow(void)
+ * @brief A static function for writing the bus to low state.
+ */
+static inline void OwWriteBusLow(void) {
+
+	OW_BUS_DIRECTION |= OW_BUS_MASK;
+	#ifdef OW_INTERNAL_PULLUP
+		OW_BUS_PORT &= ~OW_BUS_MASK;
+	#endif
+
+}
+
+/**
+ * @fn static inline uint8_t OwSampleBus(void)
+ * @brief A static function for sampling the bus.
+ *
+ * @return 0x01 if the bus is high or 0x00 if the bus is low.
+ */
+static inline uint8_t OwSampleBus(void) {
+
+	return (OW_BUS_PIN & OW_BUS_MASK) ? 0x01 : 0x00;
+
+}
+
+#ifdef OW_OVERDRIVE
+	#ifdef OW_MULTI_BUS
+		#define OW_SPEED		(ow_bus->speed)
+	#else
+		extern uint8_t ow_speed;
+		#define OW_SPEED		ow_speed
+	#endif
+	#define OW_IS_OVERDRIVE		(OW_SPEED == OW_SPEED_OVERDRIVE)
+#else
+	#define OW_IS_OVERDRIVE		0
+#endif
+
+/**
+ * @def OW_ALWAYS_INLINE
+ *
+ * Slot helpers have to be inlined for the delays to see
+ * constant arguments.
+ */
+#define OW_ALWAYS_INLINE		inline __attribute__((always_inline))
+
+/**
+ * @def OW_BUS_CYCLES
+ *
+ * Cycles spent in OwWriteBusLow() or OwWriteBusHigh(). Single
+ * SBI or CBI without internal pull-up, two with it. Multiple
+ * buses need a read-modify-write through the bus pointer.
+ */
+#ifndef OW_BUS_CYCLES
+	#if defined(OW_MULTI_BUS) && defined(OW_INTERNAL_PULLUP)
+		#define OW_BUS_CYCLES		20
+	#elif defined(OW_MULTI_BUS)
+		#define OW_BUS_CYCLES		10
+	#elif defined(OW_INTERNAL_PULLUP)
+		#define OW_BUS_CYCLES		4
+	#else
+		#define OW_BUS_CYCLES		2
+	#endif
+#endif
+
+/**
+ * @def OW_SAMPLE_CYCLES
+ *
+ * Cycles spent in OwSampleBus() and storing the sampled bit.
+ */
+#ifndef OW_SAMPLE_CYCLES
+	#ifdef OW_MULTI_BUS
+		#define OW_SAMPLE_CYCLES	9
+	#else
+		#define OW_SAMPLE_CYCLES	3
+	#endif
+#endif
+
+/**
+ * @def OW_LOOP_CYCLES
+ *
+ * Cycles spent between two slots of a byte: loop counter,
+ * shifting data and the call into the next slot.
+ */
+#ifndef OW_LOOP_CYCLES
+	#define OW_LOOP_CYCLES		8
+#endif
+
+/**
+ * @def OW_CYCLES
+ *
+ * Converts microseconds to CPU cycles at F_CPU.
+ */
+#define OW_CYCLES(us)			((uint32_t)((double)F_CPU * (us) / 1000000.0 + 0.5))
+
+/**
+ * @fn static inline void OwDelay(double us, uint8_t overhead)
+ * @brief Busy-waits given time minus the cycles the surrounding code is known to spend. Cycle count is computed at compile time for F_CPU. Waits zero cycles if the overhead alone exceeds the time.
+ *
+ * @param us		time between two bus events
+ * @param overhead	cycles spent by the code between the events
+ */
+static OW_ALWAYS_INLINE void OwDelay(double us, uint8_t overhead) {
+
+	#ifdef OW_SIM
+		(void)overhead;
+		OwSimDelay(us);
+	#else
+		__builtin_avr_delay_cycles(OW_CYCLES(us) > overhead ? OW_CYCLES(us) - overhead : 0);
+	#endif
+
+}
+
+/**
+ * @fn static inline uint8_t OwResetSlot(double low, double sample, double tail)
+ * @brief Writes reset pulse and samples presence pulse with given timing.
+ *
+ * @param low		length of reset pulse
+ * @param sample	delay from release to presence sampling
+ * @param tail		delay after presence sampling
+ *
+ * @return 0x01 if presence pulse is detected or 0x00 if no presence pulse is detected.
+ */
+static OW_ALWAYS_INLINE uint8_t OwResetSlot(double low, double sample, double tail) {
+
+	uint8_t presence;
+	#if defined(OW_BLOCK_INTERRUPTS_SAMPLE) || defined(OW_RESET_EARLY)
+		uint8_t i;
+	#endif
+
+	// drive bus low
+	OwWriteBusLow();
+	OwDelay(low, OW_BUS_CYCLES);
+
+	#ifdef OW_BLOCK_INTERRUPTS_SAMPLE
+
+		// release bus
+		OwWriteBusHigh();
+
+		// presence pulse starts a quarter of the sample delay after release at earliest
+		OwDelay(sample / 4, OW_SAMPLE_CYCLES);
+
+		// polling with interrupts enabled, an interrupt only skips a part of the pulse
+		presence = 0x01;
+		for(i = 0; i < (uint8_t)(sample * 3 / 4); i++) {
+			presence &= OwSampleBus();
+			OwDelay(1, OW_SAMPLE_CYCLES + OW_LOOP_CYCLES);
+		}
+
+	#else
+
+		#ifdef OW_BLOCK_INTERRUPTS_BITLEVEL
+			cli();
+		#endif
+		// release bus
+		OwWriteBusHigh();
+
+		// wait for presence pulse
+		OwDelay(sample, OW_SAMPLE_CYCLES);
+
+		// check for presence pulse
+		presence = OwSampleBus();
+
+		#ifdef OW_BLOCK_INTERRUPTS_BITLEVEL
+			sei();
+		#endif
+
+	#endif
+
+	#ifdef OW_RESET_EARLY
+
+		// slaves wait for a command once their presence pulse has ended
+		for(i = 0; i < (uint8_t)(tail / 2) && !OwSampleBus(); i++) {
+			OwDelay(2, OW_SAMPLE_CYCLES + OW_LOOP_CYCLES);
+		}
+
+		// recovery as long as the presence sample delay
+		OwDelay(sample, OW_BUS_CYCLES);
+
+	#else
+
+		OwDelay(tail, OW_BUS_CYCLES);
+
+	#endif
+
+	// return 0x01 if presence pulse was read
+	return presence ^ 0x01;
+
+}
+
+/**
+ * @fn static inline uint8_t OwReadSlot(double low, double sample, double tail)
+ * @brief Reads a bit with given timing.
+ *
+ * @param low		length of low pulse
+ * @param sample	delay from release to sampling
+ * @param tail		delay after sampling
+ *
+ * @return 8-bit value with the read bit as LSB
+ */
+static OW_ALWAYS_INLINE uint8_t OwReadSlot(double low, double sample, double tail) {
+
+	uint8_t bit;
+
+	#ifdef OW_BLOCK_INTERRUPTS_SAMPLE
+		cli();
+	#endif
+
+	// drive bus low
+	OwWriteBusLow();
+	OwDelay(low, OW_BUS_CYCLES);
+
+	// release bus
+	OwWriteBusHigh();
+	OwDelay(sample, OW_SAMPLE_CYCLES);
+
+	bit = OwSampleBus();
+
+	#ifdef OW_BLOCK_INTERRUPTS_SAMPLE
+		sei();
+	#endif
+
+	// recovery covers the way into the next slot
+	OwDelay(tail, OW_SAMPLE_CYCLES + OW_LOOP_CYCLES + OW_BUS_CYCLES);
+
+	return bit;
+
+}
+
+/**
+ * @fn static inline void OwWriteSlot(uint8_t data, double short_delay, double long_delay)
+ * @brief Writes a bit with given timing.
+ *
+ * @param data		8-bit value which has the bit to be written as LSB
+ * @param short_delay	low time of one bit and recovery of zero bit
+ * @param long_delay	low time of zero bit and recovery of one bit
+ */
+static OW_ALWAYS_INLINE void OwWriteSlot(uint8_t data, double short_delay, double long_delay) {
+
+	// LSB of data value is checked
+	if(data & 1) {
+
+		#ifdef OW_BLOCK_INTERRUPTS_SAMPLE
+			cli();
+		#endif
+
+		// drive bus low
+		OwWriteBusLow();
+		OwDelay(short_delay, OW_BUS_CYCLES);
+
+		// release bus
+		OwWriteBusHigh();
+
+		#ifdef OW_BLOCK_INTERRUPTS_SAMPLE
+			sei();
+		#endif
+
+		OwDelay(long_delay, OW_LOOP_CYCLES + OW_BUS_CYCLES);
+
+	} else {
+
+		// drive bus low, an interrupt may stretch the low time up to its 120 us limit
+		OwWriteBusLow();
+		OwDelay(long_delay, OW_BUS_CYCLES);
+
+		// release bus
+		OwWriteBusHigh();
+		OwDelay(short_delay, OW_LOOP_CYCLES + OW_BUS_CYCLES);
+
+	}
+
+}
+
+#ifdef OW_STRONG_PULLUP
+
+extern volatile uint8_t ow_power_on;
+
+void OwPowerStart(uint16_t ms);
+
+#endif
+
+#ifdef OW_SLEEP
+
+void OwSleepIdle(void);
+
+#endif
+
+#ifdef OW_CRC_STREAM
+
+extern uint8_t ow_crc8;
+extern uint16_t ow_crc16;
+
+#endif
+
+/**
+ * @fn static inline void OwCrcStream(uint8_t data)
+ * @brief Adds a byte to the streaming crcs if OW_CRC_STREAM is defined.
+ *
+ * @param data		byte read from or written to the bus
+ */
+static inline void OwCrcStream(uint8_t data) {
+
+	#ifdef OW_CRC_STREAM
+		ow_crc8 = OwCrc8Update(ow_crc8, data);
+		ow_crc16 = OwCrc16Update(ow_crc16, data);
+	#else
+		(void)data;
+	#endif
+
+}
+
+#ifdef OW_CALIBRATION
+
+#include <util/delay_basic.h>
+
+#ifdef OW_MULTI_BUS
+	#define OW_TIMING		(ow_bus->timing)
+#else
+	extern OwTiming ow_timing;
+	#define OW_TIMING		ow_timing
+#endif
+
+/**
+ * @fn static inline void OwDelayCount(uint16_t count)
+ * @brief Busy-waits a delay measured at runtime.
+ *
+ * @param count		_delay_loop_2() count, at least one
+ */
+static inline void OwDelayCount(uint16_t count) {
+
+	_delay_loop_2(count);
+
+}
+
+/**
+ * @fn static inline uint8_t OwResetSlotTimed(void)
+ * @brief Writes reset pulse and samples presence pulse with calibrated timing.
+ *
+ * @return 0x01 if presence pulse is detected or 0x00 if no presence pulse is detected.
+ */
+static OW_ALWAYS_INLINE uint8_t OwResetSlotTimed(void) {
+
+	uint8_t presence;
+
+	OwWriteBusLow();
+	OwDelay(OW_RESET_DELAY, OW_BUS_CYCLES);
+
+	// measured sample point instead of polling
+	#if defined(OW_BLOCK_INTERRUPTS_BITLEVEL) || defined(OW_BLOCK_INTERRUPTS_SAMPLE)
+		cli();
+	#endif
+
+	OwWriteBusHigh();
+	OwDelayCount(OW_TIMING.presence);
+
+	presence = OwSampleBus();
+
+	#if defined(OW_BLOCK_INTERRUPTS_BITLEVEL) || defined(OW_BLOCK_INTERRUPTS_SAMPLE)
+		sei();
+	#endif
+
+	OwDelayCount(OW_TIMING.reset_tail);
+
+	return presence ^ 0x01;
+
+}
+
+/**
+ * @fn static inline uint8_t OwReadSlotTimed(void)
+ * @brief Reads a bit with calibrated timing.
+ *
+ * @return 8-bit value with the read bit as LSB
+ */
+static OW_ALWAYS_INLINE uint8_t OwReadSlotTimed(void) {
+
+	uint8_t bit;
+
+	#ifdef OW_BLOCK_INTERRUPTS_SAMPLE
+		cli();
+	#endif
+
+	OwWriteBusLow();
+	OwDelay(OW_SHORT_DELAY, OW_BUS_CYCLES);
+
+	OwWriteBusHigh();
+	OwDelayCount(OW_TIMING.sample);
+
+	bit = OwSampleBus();
+
+	#ifdef OW_BLOCK_INTERRUPTS_SAMPLE
+		sei();
+	#endif
+
+	OwDelayCount(OW_TIMING.read_tail);
+
+	return bit;
+
+}
+
+/**
+ * @fn static inline void OwWriteSlotTimed(uint8_t data)
+ * @brief Writes a bit with calibrated recovery.
+ *
+ * @param data		8-bit value which has the bit to be written as LSB
+ */
+static OW_ALWAYS_INLINE void OwWriteSlotTimed(uint8_t data) {
+
+	if(data & 1) {
+
+		#ifdef OW_BLOCK_INTERRUPTS_SAMPLE
+			cli();
+		#endif
+
+		OwWriteBusLow();
+		OwDelay(OW_SHORT_DELAY, OW_BUS_CYCLES);
+
+		OwWriteBusHigh();
+
+		#ifdef OW_BLOCK_INTERRUPTS_SAMPLE
+			sei();
+		#endif
+
+		OwDelayCount(OW_TIMING.one_tail);
+
+	} else {
+
+		OwWriteBusLow();
+		OwDelay(OW_LONG_DELAY, OW_BUS_CYCLES);
+
+		OwWriteBusHigh();
+		OwDelayCount(OW_TIMING.zero_tail);
+
+	}
+
+}
+
+#endif
+
+#ifdef OW_STATS
+
+extern OwStats ow_stats;
+
+	#define OW_STAT_INC(field)		(ow_stats.field++)
+	#define OW_STAT_ADD(field, n)		(ow_stats.field += (n))
+	// bus busy time between the two is added to the counters
+	#define OW_STAT_BEGIN()			uint16_t ow_stat_start = OW_STATS_CLOCK()
+	#define OW_STAT_END()			(ow_stats.busy_ticks += (uint16_t)(OW_STATS_CLOCK() - ow_stat_start))
+
+#else
+
+	#define OW_STAT_INC(field)
+	#define OW_STAT_ADD(field, n)
+	#define OW_STAT_BEGIN()
+	#define OW_STAT_END()
+
+#endif
+
+#ifdef OW_TRACE
+
+void OwTraceAdd(uint8_t event, uint8_t data);
+
+	#define OW_TRACE_EVENT(event, data)	OwTraceAdd((event), (data))
+
+#else
+
+	#define OW_TRACE_EVENT(event, data)
+
+#endif
+
+/**
+ * @def OW_OP_RESET
+ *
+ * Bus operation: reset pulse and presence detection.
+ */
+#define OW_OP_RESET			0
+/**
+ * @def OW_OP_READ
+ *
+ * Bus operation: read time slots.
+ */
+#define OW_OP_READ			1
+/**
+ * @def OW_OP_WRITE
+ *
+ * Bus operation: write time slots.
+ */
+#define OW_OP_WRITE			2
+/**
+ * @def OW_OP_DONE
+ *
+ * No operations left.
+ */
+#define OW_OP_DONE			3
+
+// transaction stages, executed in this order
+#define OW_TXN_STAGE_RESET		0
+#define OW_TXN_STAGE_SELECT		1
+#define OW_TXN_STAGE_ROM		2
+#define OW_TXN_STAGE_WRITE		3
+#define OW_TXN_STAGE_READ		4
+#define OW_TXN_STAGE_END		5
+
+/**
+ * @struct OwTxnCursors
+ *
+ * Position in a transaction queue.
+ */
+typedef struct OwTxnCursors {
+	OwContext* ctx;
+	OwTransaction* txn;		// current transaction
+	uint8_t count;			// transactions left
+	uint8_t stage;			// OW_TXN_STAGE_*
+	uint8_t pos;			// byte index within the stage
+	uint8_t found;			// transactions with presence pulse
+	uint8_t crc;			// CRC8 of the bytes read
+	uint8_t retry;			// attempts repeated for the current transaction
+	uint8_t backoff;		// retry to wait for before the next reset, 0 for none
+} OwTxnCursor;
+
+uint8_t OwTxnNext(OwTxnCursor* cur, uint8_t* data);
+void OwTxnResult(OwTxnCursor* cur, uint8_t result);
+
+#ifdef OW_ASYNC
+
+/**
+ * @struct OwAsyncStates
+ *
+ * State of the interrupt-driven engine shared by the front end
+ * and the backend.
+ */
+typedef struct OwAsyncStates {
+	uint8_t op;			// current operation
+	uint8_t phase;			// next step of the backend
+	uint8_t data;			// bits to write or bits read
+	uint8_t mask;			// current bit
+	uint8_t bits;			// bits left
+	uint8_t result;			// result of the last operation
+	uint8_t busy;			// operation in progress
+	uint8_t txn;			// running a transaction queue
+	OwAsyncCallback done;		// completion callback
+} OwAsyncState;
+
+extern volatile OwAsyncState ow_async;
+
+void OwAsyncStart(uint8_t op, uint8_t data, uint8_t bits, OwAsyncCallback done);
+uint8_t OwAsyncOpDone(void);
+uint8_t OwAsyncNextBit(void);
+
+// implemented by the backend
+void OwBackendInit(void);
+void OwBackendKick(void);
+void OwBackendStop(void);
+
+#endif
+
+#endif
@@ -0,0 +1,225 @@
+/**
+ * @file onewire_cache.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Rom table cache in EEPROM. The roms found by the last search are
+ * stored with a version byte and CRC16. At startup the cached roms are
+ * checked with cheaper commands than a search pass: Read rom for a
+ * single device, a crc-checked scratchpad read for DS18B20 sensors.
+ *
+ * EEPROM layout at OW_CACHE_ADDRESS: version, count, count * 8 rom
+ * bytes and CRC16 of the preceding bytes, LSB first.
+ */
+
+#include <string.h>
+#include "onewire_bus.h"
+
+#ifdef OW_ROM_CACHE
+
+#include <avr/eeprom.h>
+
+/**
+ * @def OW_CACHE_VERSION
+ *
+ * Layout version stored in the first byte of the cache.
+ */
+#define OW_CACHE_VERSION		1
+
+#define OW_CACHE_EEPROM(offset)		((uint8_t*)(OW_CACHE_ADDRESS) + (offset))
+
+/**
+ * @fn static uint16_t OwCacheCrc(uint8_t count, uint8_t (*roms)[8], uint8_t slots)
+ * @brief Computes CRC16 of the cache header and roms. Free slots are skipped as they are not cached.
+ *
+ * @param count		number of roms
+ * @param roms		roms to cover
+ * @param slots		number of slots holding the roms
+ *
+ * @return crc of the cache contents
+ */
+static uint16_t OwCacheCrc(uint8_t count, uint8_t (*roms)[8], uint8_t slots) {
+
+	uint8_t i, j;
+	uint8_t n = 0;
+	uint16_t crc = 0;
+
+	crc = OwCrc16Update(crc, OW_CACHE_VERSION);
+	crc = OwCrc16Update(crc, count);
+
+	for(i = 0; i < slots && n < count; i++) {
+
+		if(!roms[i][0]) {
+			continue;
+		}
+
+		for(j = 0; j < 8; j++) {
+			crc = OwCrc16Update(crc, roms[i][j]);
+		}
+
+		n++;
+
+	}
+
+	return crc;
+
+}
+
+/**
+ * @fn void OwCacheStore(OwContext* ctx)
+ * @brief Stores the roms of a context into the cache. Free slots left by a rescan are dropped, so the cached roms are packed. Only changed bytes are written to save EEPROM wear. At most OW_MAX_ROMS roms are cached.
+ *
+ * @param ctx		context holding the roms
+ */
+void OwCacheStore(OwContext* ctx) {
+
+	uint8_t i;
+	uint8_t count = 0;
+	uint16_t crc;
+
+	// cache is invalid until the version is written back
+	eeprom_update_byte(OW_CACHE_EEPROM(0), 0xFF);
+
+	for(i = 0; i < ctx->count && count < OW_MAX_ROMS; i++) {
+
+		if(ctx->roms[i][0]) {
+
+			eeprom_update_block(ctx->roms[i], OW_CACHE_EEPROM(2 + count * 8), 8);
+			count++;
+
+		}
+
+	}
+
+	crc = OwCacheCrc(count, ctx->roms, ctx->count);
+
+	eeprom_update_byte(OW_CACHE_EEPROM(1), count);
+	eeprom_update_byte(OW_CACHE_EEPROM(2 + count * 8), (uint8_t)crc);
+	eeprom_update_byte(OW_CACHE_EEPROM(3 + count * 8), crc >> 8);
+
+	eeprom_update_byte(OW_CACHE_EEPROM(0), OW_CACHE_VERSION);
+
+}
+
+/**
+ * @fn uint8_t OwCacheLoad(OwContext* ctx)
+ * @brief Loads cached roms into a context without touching the bus.
+ *
+ * @param ctx		context for the roms
+ *
+ * @return		0x01 if the cache was valid and loaded, otherwise 0x00.
+ */
+uint8_t OwCacheLoad(OwContext* ctx) {
+
+	uint8_t i;
+	uint8_t count;
+	uint16_t crc;
+
+	if(eeprom_read_byte(OW_CACHE_EEPROM(0)) != OW_CACHE_VERSION) {
+		return 0;
+	}
+
+	count = eeprom_read_byte(OW_CACHE_EEPROM(1));
+
+	if(count > OW_MAX_ROMS || count > OW_CTX_CAPACITY(ctx)) {
+		return 0;
+	}
+
+	eeprom_read_block(ctx->roms, OW_CACHE_EEPROM(2), count * 8);
+
+	crc = eeprom_read_byte(OW_CACHE_EEPROM(2 + count * 8));
+	crc |= eeprom_read_byte(OW_CACHE_EEPROM(3 + count * 8)) << 8;
+
+	if(crc != OwCacheCrc(count, ctx->roms, count)) {
+
+		ctx->count = 0;
+		return 0;
+
+	}
+
+	for(i = 0; i < count; i++) {
+		ctx->resolution[i] = 0;
+	}
+
+	ctx->count = count;
+	OW_CTX_SINGLE(ctx, 0);
+	OW_ROM_SORT(ctx);
+
+	return 1;
+
+}
+
+/**
+ * @fn static uint8_t OwCacheProbe(OwContext* ctx, uint8_t rom)
+ * @brief Checks that a cached device answers. DS18B20 sensors are read with Match rom and a crc-checked scratchpad, 152 slots against 200 of a search pass, other families are verified with OwVerify().
+ *
+ * @param ctx		context holding the roms
+ * @param rom		index of the rom in context
+ *
+ * @return		0x01 if the device answered, otherwise 0x00.
+ */
+static uint8_t OwCacheProbe(OwContext* ctx, uint8_t rom) {
+
+	uint8_t buf[1];
+
+	// an absent device reads as all ones, which fails the crc
+	if(ctx->roms[rom][0] == OW_DS18B20_FAMILY) {
+		return OwReadScratchpad(ctx, rom, buf, 0, 1);
+	}
+
+	return OwVerify(ctx, ctx->roms[rom]);
+
+}
+
+/**
+ * @fn uint8_t OwCacheStartup(OwContext* ctx)
+ * @brief Fills a context at startup. A single cached rom is checked with OwReadRom(), which also proves that no other device has been attached. Several cached roms are checked one by one without a search. Falls back to OwSearchRom() and stores the result when the cache is invalid or any cached device does not answer. With several cached roms, devices added since the cache was stored are not detected while every cached device answers.
+ *
+ * @param ctx		context for the roms
+ *
+ * @return number of roms in the context
+ */
+uint8_t OwCacheStartup(OwContext* ctx) {
+
+	uint8_t i;
+	uint8_t cached[8];
+
+	if(OwCacheLoad(ctx) && ctx->count) {
+
+		if(ctx->count == 1) {
+
+			// 72 slots, several devices answering at once fail the crc
+			memcpy(cached, ctx->roms[0], 8);
+
+			if(OwReadRom(ctx) && !memcmp(cached, ctx->roms[0], 8)) {
+				return 1;
+			}
+
+		} else {
+
+			for(i = 0; i < ctx->count; i++) {
+
+				if(!OwCacheProbe(ctx, i)) {
+					break;
+				}
+
+			}
+
+			if(i == ctx->count) {
+				return ctx->count;
+			}
+
+		}
+
+	}
+
+	OwSearchRom(ctx);
+	OwCacheStore(ctx);
+
+	return ctx->count;
+
+}
+
+#endif
@@ -0,0 +1,390 @@
+/**
+ * @file onewire_convert.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Conversion scheduler for DS18B20 and compatible sensors. All sensors
+ * on a bus are started with one Skip rom and Convert T, the conversion
+ * time is tracked with millisecond ticks supplied by the application
+ * and the results are collected with Match rom and scratchpad reads.
+ */
+
+#include <string.h>
+#include "onewire_bus.h"
+
+/**
+ * @fn uint16_t OwConvertTime(uint8_t resolution)
+ * @brief Returns the maximum conversion time of DS18B20 at given resolution.
+ *
+ * @param resolution	resolution in bits, 9 to 12
+ *
+ * @return conversion time in milliseconds
+ */
+uint16_t OwConvertTime(uint8_t resolution) {
+
+	switch(resolution) {
+
+		case 9:
+			return 94;
+
+		case 10:
+			return 188;
+
+		case 11:
+			return 375;
+
+		default:
+			return 750;
+
+	}
+
+}
+
+/**
+ * @fn uint8_t OwSetResolution(OwContext* ctx, uint8_t rom, uint8_t resolution)
+ * @brief Writes resolution of a DS18B20 with Write scratchpad and stores it into the context. Alarm thresholds are read first and written back unchanged. Resolution is not copied to the EEPROM of the sensor.
+ *
+ * @param ctx		context holding the roms
+ * @param rom		index of the rom in context
+ * @param resolution	resolution in bits, 9 to 12
+ *
+ * @return		0x01 if the resolution was written, otherwise 0x00.
+ */
+uint8_t OwSetResolution(OwContext* ctx, uint8_t rom, uint8_t resolution) {
+
+	uint8_t sp[5];
+
+	if(resolution < 9) {
+		resolution = 9;
+	} else if(resolution > 12) {
+		resolution = 12;
+	}
+
+	// TH and TL share the write with the configuration register
+	if(!OwReadScratchpad(ctx, rom, sp, 5, 1)) {
+		return 0;
+	}
+
+	if(!OwReset()) {
+		return 0;
+	}
+
+	OwWriteByteTo(ctx, rom, OW_WRITE_SCRATCHPAD);
+	OwWriteByte(sp[2]);
+	OwWriteByte(sp[3]);
+	OwWriteByte(((resolution - 9) << 5) | 0x1F);
+
+	ctx->resolution[rom] = resolution;
+
+	return 1;
+
+}
+
+/**
+ * @fn static uint8_t OwConvertDue(OwConvert* conv, uint8_t rom, uint16_t now)
+ * @brief Checks whether a sensor has not been read yet and its conversion time has passed.
+ *
+ * @param conv		scheduler
+ * @param rom		index of the rom in context
+ * @param now		current millisecond tick of the application
+ *
+ * @return		0x01 if the sensor can be read, otherwise 0x00.
+ */
+static uint8_t OwConvertDue(OwConvert* conv, uint8_t rom, uint16_t now) {
+
+	// slot may have been freed by a rescan during the conversion
+	if(!(conv->pending[rom >> 3] & (1 << (rom & 7))) || !conv->ctx->roms[rom][0]) {
+		return 0;
+	}
+
+	// zero wait marks every sensor done
+	return !conv->wait || (uint16_t)(now - conv->start) >= OwConvertTime(conv->ctx->resolution[rom]);
+
+}
+
+/**
+ * @fn void OwConvertInit(OwConvert* conv, OwContext* ctx, uint8_t flags)
+ * @brief Initializes a conversion scheduler for the devices of a context. Conversion times are taken from the resolutions stored in the context.
+ *
+ * @param conv		scheduler
+ * @param ctx		context holding the roms of the sensors
+ * @param flags		OW_CONVERT_POLL, OW_CONVERT_VERIFY and OW_CONVERT_POWER
+ */
+void OwConvertInit(OwConvert* conv, OwContext* ctx, uint8_t flags) {
+
+	conv->ctx = ctx;
+	conv->flags = flags;
+	conv->state = OW_CONVERT_IDLE;
+
+}
+
+/**
+ * @fn uint8_t OwConvertStart(OwConvert* conv, uint16_t now)
+ * @brief Starts conversion on every sensor of the bus with Skip rom and Convert T. Returns right after the command.
+ *
+ * @param conv		scheduler
+ * @param now		current millisecond tick of the application
+ *
+ * @return		0x01 if presence pulse was detected and conversion started, otherwise 0x00.
+ */
+uint8_t OwConvertStart(OwConvert* conv, uint16_t now) {
+
+	uint8_t i;
+	uint16_t time;
+
+	#ifdef OW_CONTEXT_BUFFER
+		// pending sensors are tracked for OW_MAX_ROMS devices
+		if(conv->ctx->count > OW_MAX_ROMS) {
+
+			conv->state = OW_CONVERT_IDLE;
+			return 0;
+
+		}
+	#endif
+
+	// strong pull-up has to last for the slowest sensor
+	conv->wait = 0;
+	memset(conv->pending, 0, sizeof(conv->pending));
+
+	for(i = 0; i < conv->ctx->count; i++) {
+
+		// free slot left by a rescan
+		if(!conv->ctx->roms[i][0]) {
+			continue;
+		}
+
+		time = OwConvertTime(conv->ctx->resolution[i]);
+
+		if(time > conv->wait) {
+			conv->wait = time;
+		}
+
+		conv->pending[i >> 3] |= 1 << (i & 7);
+
+	}
+
+	conv->read = 0;
+
+	OW_SELECT_CTX(conv->ctx);
+
+	if(!conv->ctx->count || !OwReset()) {
+
+		conv->state = OW_CONVERT_IDLE;
+		return 0;
+
+	}
+
+	OwWriteByte(OW_SKIP_ROM);
+
+	#ifdef OW_STRONG_PULLUP
+
+		if(conv->flags & OW_CONVERT_POWER) {
+
+			// parasite sensors are powered for the whole conversion
+			OwWriteBytePower(OW_CONVERT_T, conv->wait);
+
+		} else {
+
+			OwWriteByte(OW_CONVERT_T);
+
+		}
+
+	#else
+
+		OwWriteByte(OW_CONVERT_T);
+
+	#endif
+
+	conv->start = now;
+	conv->state = OW_CONVERT_BUSY;
+
+	return 1;
+
+}
+
+/**
+ * @fn uint8_t OwConvertUpdate(OwConvert* conv, uint16_t now)
+ * @brief Checks whether conversion of any unread sensor has finished. Never waits for the conversion. With OW_CONVERT_POLL read time slots are polled for the done status of the sensors until the first sensor has been read. With OW_CONVERT_POWER every sensor is ready once the strong pull-up has been released.
+ *
+ * @param conv		scheduler
+ * @param now		current millisecond tick of the application
+ *
+ * @return state of the scheduler, OW_CONVERT_READY once results can be read
+ */
+uint8_t OwConvertUpdate(OwConvert* conv, uint16_t now) {
+
+	uint8_t i;
+
+	if(conv->state != OW_CONVERT_BUSY) {
+		return conv->state;
+	}
+
+	#ifdef OW_STRONG_PULLUP
+
+		// bus is released by the timer once the slowest sensor is done
+		if(conv->flags & OW_CONVERT_POWER) {
+
+			if(!OwPowerActive()) {
+
+				conv->wait = 0;
+				conv->state = OW_CONVERT_READY;
+
+			}
+
+			return conv->state;
+
+		}
+
+	#endif
+
+	for(i = 0; i < conv->ctx->count; i++) {
+
+		if(OwConvertDue(conv, i, now)) {
+
+			conv->state = OW_CONVERT_READY;
+			return conv->state;
+
+		}
+
+	}
+
+	// done status is sent only until the next reset
+	if((conv->flags & OW_CONVERT_POLL) && !conv->read) {
+
+		OW_SELECT_CTX(conv->ctx);
+
+		// converting sensors hold read slots low
+		if(OwReadByte() == 0xFF) {
+
+			conv->wait = 0;
+			conv->state = OW_CONVERT_READY;
+
+		}
+
+	}
+
+	return conv->state;
+
+}
+
+#ifdef OW_SLEEP
+
+/**
+ * @fn uint16_t OwConvertSleep(OwConvert* conv, uint16_t now)
+ * @brief Sleeps until the next sensor of a running conversion is due. With OW_CONVERT_POWER the MCU sleeps in idle mode until the strong pull-up is released, otherwise in power-down.
+ *
+ * @param conv		scheduler
+ * @param now		current millisecond tick of the application
+ *
+ * @return		tick after the sleep, now advanced by the time spent in power-down
+ */
+uint16_t OwConvertSleep(OwConvert* conv, uint16_t now) {
+
+	uint8_t i;
+	uint16_t elapsed;
+	uint16_t time;
+	uint16_t rest = 0xFFFF;
+
+	if(conv->state != OW_CONVERT_BUSY || !conv->wait) {
+		return now;
+	}
+
+	#ifdef OW_STRONG_PULLUP
+		if(conv->flags & OW_CONVERT_POWER) {
+			return now + OwSleep(0);
+		}
+	#endif
+
+	elapsed = now - conv->start;
+
+	for(i = 0; i < conv->ctx->count; i++) {
+
+		if(!(conv->pending[i >> 3] & (1 << (i & 7))) || !conv->ctx->roms[i][0]) {
+			continue;
+		}
+
+		time = OwConvertTime(conv->ctx->resolution[i]);
+
+		// a sensor is already due
+		if(elapsed >= time) {
+			return now;
+		}
+
+		if(time - elapsed < rest) {
+			rest = time - elapsed;
+		}
+
+	}
+
+	return rest == 0xFFFF ? now : now + OwSleep(rest);
+
+}
+
+#endif
+
+/**
+ * @fn uint8_t OwConvertRead(OwConvert* conv, int16_t* temps, uint16_t now)
+ * @brief Reads the temperature registers of the sensors whose conversion has finished. Only the first two scratchpad bytes are read unless OW_CONVERT_VERIFY is set. Scheduler returns to OW_CONVERT_BUSY while slower sensors are still converting and to OW_CONVERT_IDLE after the last one.
+ *
+ * @param conv		scheduler
+ * @param temps		raw temperatures in 1/16 degrees, indexed as the roms of the context, free slots are set to OW_TEMP_INVALID
+ * @param now		current millisecond tick of the application
+ *
+ * @return number of temperatures read, failed reads are set to OW_TEMP_INVALID
+ */
+uint8_t OwConvertRead(OwConvert* conv, int16_t* temps, uint16_t now) {
+
+	uint8_t i;
+	uint8_t found = 0;
+	uint8_t pending = 0;
+	uint8_t buf[2];
+
+	if(conv->state != OW_CONVERT_READY) {
+		return 0;
+	}
+
+	for(i = 0; i < conv->ctx->count; i++) {
+
+		// free slot left by a rescan
+		if(!conv->ctx->roms[i][0]) {
+
+			temps[i] = OW_TEMP_INVALID;
+			conv->pending[i >> 3] &= ~(1 << (i & 7));
+			continue;
+
+		}
+
+		if(!OwConvertDue(conv, i, now)) {
+
+			// slower sensor still converting
+			if(conv->pending[i >> 3] & (1 << (i & 7))) {
+				pending = 1;
+			}
+
+			continue;
+
+		}
+
+		if(OwReadScratchpad(conv->ctx, i, buf, 2, conv->flags & OW_CONVERT_VERIFY)) {
+
+			temps[i] = (int16_t)((buf[1] << 8) | buf[0]);
+			found++;
+
+		} else {
+
+			temps[i] = OW_TEMP_INVALID;
+
+		}
+
+		conv->pending[i >> 3] &= ~(1 << (i & 7));
+		conv->read++;
+
+	}
+
+	conv->state = pending ? OW_CONVERT_BUSY : OW_CONVERT_IDLE;
+
+	return found;
+
+}
@@ -0,0 +1,74 @@
+/**
+ * @file onewire_ds18b20.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * DS18B20 temperature sensor. Scratchpad bytes are decoded as they
+ * are read, temperatures are kept as raw fixed-point 1/16 C.
+ */
+
+#include "onewire_bus.h"
+
+/**
+ * @def OW_DS18B20_READ_POWER
+ *
+ * Read power supply command.
+ */
+#define OW_DS18B20_READ_POWER		0xB4
+
+/**
+ * @fn uint8_t OwDs18b20Read(OwContext* ctx, uint8_t rom, int16_t* temp, uint8_t verify)
+ * @brief Reads the temperature register of a sensor with OwReadScratchpadStatus(). Without verify the transfer is ended with a reset after the two temperature bytes, with verify the rest of the scratchpad is clocked through the crc.
+ *
+ * @param ctx		context holding the roms
+ * @param rom		index of the rom in context or OW_TXN_SKIP_ROM
+ * @param temp		temperature in 1/16 C, OW_TEMP_INVALID if the read failed
+ * @param verify	0x01 to check the crc of the scratchpad
+ *
+ * @return		OW_OK, OW_ERR_NO_PRESENCE or OW_ERR_CRC
+ */
+uint8_t OwDs18b20Read(OwContext* ctx, uint8_t rom, int16_t* temp, uint8_t verify) {
+
+	uint8_t buf[2];
+	uint8_t status;
+
+	status = OwReadScratchpadStatus(ctx, rom, buf, 2, verify);
+
+	if(status != OW_OK) {
+
+		*temp = OW_TEMP_INVALID;
+		return status;
+
+	}
+
+	*temp = (int16_t)((buf[1] << 8) | buf[0]);
+
+	return OW_OK;
+
+}
+
+/**
+ * @fn uint8_t OwDs18b20Parasite(OwContext* ctx, uint8_t rom, uint8_t* parasite)
+ * @brief Checks whether a sensor is parasite powered with Read power supply. With OW_TXN_SKIP_ROM any parasite powered sensor of the bus is reported.
+ *
+ * @param ctx		context holding the roms
+ * @param rom		index of the rom in context or OW_TXN_SKIP_ROM
+ * @param parasite	0x01 if parasite powered, 0x00 if externally powered
+ *
+ * @return		OW_OK or OW_ERR_NO_PRESENCE
+ */
+uint8_t OwDs18b20Parasite(OwContext* ctx, uint8_t rom, uint8_t* parasite) {
+
+	if(!OwCommand(ctx, rom, OW_DS18B20_READ_POWER)) {
+		return OW_ERR_NO_PRESENCE;
+	}
+
+	// parasite powered sensors pull the read slot low
+	*parasite = !(OwReadByte() & 0x01);
+	OwReset();
+
+	return OW_OK;
+
+}
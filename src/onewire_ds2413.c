@@ -0,0 +1,104 @@
+/**
+ * @file onewire_ds2413.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * DS2413 dual channel addressable switch. The status byte carries its
+ * own complement in the upper nibble, which is checked instead of a
+ * crc.
+ */
+
+#include "onewire_bus.h"
+
+/**
+ * @def OW_DS2413_PIO_READ
+ *
+ * PIO access commands and the confirmation byte of a write.
+ */
+#define OW_DS2413_PIO_READ		0xF5
+#define OW_DS2413_PIO_WRITE		0x5A
+#define OW_DS2413_CONFIRM		0xAA
+
+/**
+ * @fn static uint8_t OwDs2413Status(uint8_t data)
+ * @brief Checks a status byte against its complement.
+ *
+ * @param data		status byte
+ *
+ * @return		0x01 if the upper nibble is the complement of the lower one
+ */
+static uint8_t OwDs2413Status(uint8_t data) {
+
+	return ((data ^ (data >> 4)) & 0x0F) == 0x0F;
+
+}
+
+/**
+ * @fn uint8_t OwDs2413Read(OwContext* ctx, uint8_t rom, uint8_t* state)
+ * @brief Reads pin states and output latches of both channels.
+ *
+ * @param ctx		context holding the roms
+ * @param rom		index of the rom in context or OW_TXN_SKIP_ROM
+ * @param state		OW_DS2413_PIOA, OW_DS2413_LATCHA, OW_DS2413_PIOB and OW_DS2413_LATCHB bits
+ *
+ * @return		OW_OK, OW_ERR_NO_PRESENCE or OW_ERR_CRC
+ */
+uint8_t OwDs2413Read(OwContext* ctx, uint8_t rom, uint8_t* state) {
+
+	uint8_t data;
+
+	if(!OwCommand(ctx, rom, OW_DS2413_PIO_READ)) {
+		return OW_ERR_NO_PRESENCE;
+	}
+
+	data = OwReadByte();
+
+	// status is repeated until reset
+	OwReset();
+
+	if(!OwDs2413Status(data)) {
+		OW_STAT_INC(crc_errors);
+		return OW_ERR_CRC;
+	}
+
+	*state = data & 0x0F;
+
+	return OW_OK;
+
+}
+
+/**
+ * @fn uint8_t OwDs2413Write(OwContext* ctx, uint8_t rom, uint8_t latches)
+ * @brief Writes the output latches of both channels. The byte is sent with its complement and the device confirms it before changing the outputs.
+ *
+ * @param ctx		context holding the roms
+ * @param rom		index of the rom in context or OW_TXN_SKIP_ROM
+ * @param latches	bit 0 for PIOA and bit 1 for PIOB, zero turns the output on
+ *
+ * @return		OW_OK, OW_ERR_NO_PRESENCE or OW_ERR_CRC if the write was not confirmed
+ */
+uint8_t OwDs2413Write(OwContext* ctx, uint8_t rom, uint8_t latches) {
+
+	uint8_t data = 0xFC | latches;
+	uint8_t result = OW_OK;
+
+	if(!OwCommand(ctx, rom, OW_DS2413_PIO_WRITE)) {
+		return OW_ERR_NO_PRESENCE;
+	}
+
+	OwWriteByte(data);
+	OwWriteByte(~data);
+
+	// confirmation is followed by the new status
+	if(OwReadByte() != OW_DS2413_CONFIRM || !OwDs2413Status(OwReadByte())) {
+		OW_STAT_INC(crc_errors);
+		result = OW_ERR_CRC;
+	}
+
+	OwReset();
+
+	return result;
+
+}
@@ -0,0 +1,154 @@
+/**
+ * @file onewire_ds2431.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * DS2431 1024-bit EEPROM. Memory is read with Read memory and given
+ * to a callback byte by byte as it arrives without buffering, rows
+ * are written through the scratchpad with the crc16 and authorization
+ * checks of the device.
+ */
+
+#include "onewire_bus.h"
+
+/**
+ * @def OW_DS2431_WRITE_SCRATCHPAD
+ *
+ * Memory function commands.
+ */
+#define OW_DS2431_WRITE_SCRATCHPAD	0x0F
+#define OW_DS2431_READ_SCRATCHPAD	0xAA
+#define OW_DS2431_COPY_SCRATCHPAD	0x55
+#define OW_DS2431_READ_MEMORY		0xF0
+
+/**
+ * @def OW_DS2431_PROGRAM_TIME
+ *
+ * Programming time of Copy scratchpad in ms, specified as 10 ms max.
+ */
+#define OW_DS2431_PROGRAM_TIME		10
+
+/**
+ * @def OW_DS2431_COPY_DONE
+ *
+ * Pattern sent after a successful copy.
+ */
+#define OW_DS2431_COPY_DONE		0xAA
+
+/**
+ * @fn uint8_t OwDs2431Read(OwContext* ctx, uint8_t rom, uint8_t address, uint8_t len, OwBlockCallback data)
+ * @brief Reads memory from given address with OwReadStream(). Each byte is given to the callback as it arrives without being stored and returning 0x00 from it ends the read early.
+ *
+ * @param ctx		context holding the roms
+ * @param rom		index of the rom in context or OW_TXN_SKIP_ROM
+ * @param address	first address, below OW_DS2431_SIZE
+ * @param len		number of bytes
+ * @param data		called with position from the first address and value of each byte
+ *
+ * @return		number of bytes read, 0x00 if no presence pulse was detected
+ */
+uint8_t OwDs2431Read(OwContext* ctx, uint8_t rom, uint8_t address, uint8_t len, OwBlockCallback data) {
+
+	uint8_t ta[2] = { address, 0x00 };
+
+	if(!OwCommand(ctx, rom, OW_DS2431_READ_MEMORY)) {
+		return 0;
+	}
+
+	OwWriteBlock(ta, 2);
+	len = OwReadStream(len, data);
+
+	// device sends until the end of memory or reset
+	OwReset();
+
+	return len;
+
+}
+
+/**
+ * @fn uint8_t OwDs2431WriteRow(OwContext* ctx, uint8_t rom, uint8_t address, const uint8_t* data)
+ * @brief Writes an 8-byte row. Scratchpad write is checked with the crc16 of the device, the target address and end offset are verified with Read scratchpad and then given back as authorization to Copy scratchpad. Programming time is spent with the strong pull-up on when OW_STRONG_PULLUP is defined, idling with OW_SLEEP until the pull-up is released, and otherwise busy-waited so the caller keeps its timers.
+ *
+ * @param ctx		context holding the roms
+ * @param rom		index of the rom in context, Skip rom is only valid for a single device
+ * @param address	start of the row, a multiple of OW_DS2431_ROW
+ * @param data		OW_DS2431_ROW bytes
+ *
+ * @return		OW_OK, OW_ERR_NO_PRESENCE or OW_ERR_CRC if a check failed
+ */
+uint8_t OwDs2431WriteRow(OwContext* ctx, uint8_t rom, uint8_t address, const uint8_t* data) {
+
+	uint8_t i;
+	uint8_t status;
+	uint16_t crc;
+
+	if(!OwCommand(ctx, rom, OW_DS2431_WRITE_SCRATCHPAD)) {
+		return OW_ERR_NO_PRESENCE;
+	}
+
+	crc = OwCrc16Update(0, OW_DS2431_WRITE_SCRATCHPAD);
+	crc = OwCrc16Update(crc, address);
+	crc = OwCrc16Update(crc, 0x00);
+
+	OwWriteByte(address);
+	OwWriteByte(0x00);
+
+	for(i = 0; i < OW_DS2431_ROW; i++) {
+		crc = OwCrc16Update(crc, data[i]);
+		OwWriteByte(data[i]);
+	}
+
+	// inverted crc16, LSB first
+	crc = ~crc;
+	if(OwReadByte() != (uint8_t)crc || OwReadByte() != (uint8_t)(crc >> 8)) {
+		OW_STAT_INC(crc_errors);
+		return OW_ERR_CRC;
+	}
+
+	if(!OwCommand(ctx, rom, OW_DS2431_READ_SCRATCHPAD)) {
+		return OW_ERR_NO_PRESENCE;
+	}
+
+	// whole row written: end offset 7, no partial or authorization flag
+	i = OwReadByte();
+	status = OwReadByte() == 0x00 && i == address;
+	status = OwReadByte() == (OW_DS2431_ROW - 1) && status;
+
+	if(!status) {
+		OwReset();
+		return OW_ERR_CRC;
+	}
+
+	if(!OwCommand(ctx, rom, OW_DS2431_COPY_SCRATCHPAD)) {
+		return OW_ERR_NO_PRESENCE;
+	}
+
+	OwWriteByte(address);
+	OwWriteByte(0x00);
+
+	// programming starts after the end offset, parasite power has to last through it
+	#ifdef OW_STRONG_PULLUP
+
+		OwWriteBytePower(OW_DS2431_ROW - 1, OW_DS2431_PROGRAM_TIME);
+
+		#ifdef OW_SLEEP
+			OwSleep(0);
+		#else
+			while(OwPowerActive());
+		#endif
+
+	#else
+
+		OwWriteByte(OW_DS2431_ROW - 1);
+		OwDelay(OW_DS2431_PROGRAM_TIME * 1000UL, 0);
+
+	#endif
+
+	status = OwReadByte() == OW_DS2431_COPY_DONE;
+	OwReset();
+
+	return status ? OW_OK : OW_ERR_CRC;
+
+}
@@ -0,0 +1,121 @@
+/**
+ * @file onewire_edge.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Pin change capture of low pulses driven by slaves on an idle bus.
+ * Only the mask bit of the bus pin is touched, other pins of the same
+ * pin change group keep their settings.
+ */
+
+#include "onewire_bus.h"
+
+#ifdef OW_EDGE
+
+static volatile uint16_t ow_edge_fall;
+static volatile uint8_t ow_edge_low;
+static volatile uint8_t ow_edge_count;
+static OwEdgeEvent ow_edge_event;
+static OwEdgeCallback ow_edge_callback;
+
+/**
+ * @fn void OwEdgeArm(OwEdgeCallback callback)
+ * @brief Starts capturing low pulses of the bus. The bus cannot be used until OwEdgeDisarm().
+ *
+ * @param callback	called from the interrupt after each pulse or 0
+ */
+void OwEdgeArm(OwEdgeCallback callback) {
+
+	uint8_t sreg = SREG;
+
+	cli();
+
+	ow_edge_callback = callback;
+	ow_edge_count = 0;
+	ow_edge_low = !OwSampleBus();
+	ow_edge_fall = OW_STATS_CLOCK();
+
+	PCIFR = 1 << OW_EDGE_PCIF;
+	OW_EDGE_PCMSK |= OW_BUS_MASK;
+	PCICR |= 1 << OW_EDGE_PCIE;
+
+	SREG = sreg;
+
+}
+
+/**
+ * @fn void OwEdgeDisarm(void)
+ * @brief Stops capturing so that the bus can be used again.
+ */
+void OwEdgeDisarm(void) {
+
+	uint8_t sreg = SREG;
+
+	cli();
+	OW_EDGE_PCMSK &= ~OW_BUS_MASK;
+	SREG = sreg;
+
+}
+
+/**
+ * @fn uint8_t OwEdgeRead(OwEdgeEvent* event)
+ * @brief Gives the last low pulse and the number of pulses since the previous call.
+ *
+ * @param event		destination of the last pulse, left untouched if there were none
+ *
+ * @return		number of pulses, saturates at 255
+ */
+uint8_t OwEdgeRead(OwEdgeEvent* event) {
+
+	uint8_t count;
+	uint8_t sreg = SREG;
+
+	cli();
+
+	count = ow_edge_count;
+	ow_edge_count = 0;
+
+	if(count) {
+		*event = ow_edge_event;
+	}
+
+	SREG = sreg;
+
+	return count;
+
+}
+
+ISR(OW_EDGE_vect) {
+
+	uint16_t now = OW_STATS_CLOCK();
+
+	// other pins of the group share the vector
+	if(!OwSampleBus()) {
+
+		if(!ow_edge_low) {
+			ow_edge_low = 1;
+			ow_edge_fall = now;
+		}
+
+	} else if(ow_edge_low) {
+
+		ow_edge_low = 0;
+
+		ow_edge_event.time = ow_edge_fall;
+		ow_edge_event.width = now - ow_edge_fall;
+
+		if(ow_edge_count != 0xFF) {
+			ow_edge_count++;
+		}
+
+		if(ow_edge_callback) {
+			ow_edge_callback(&ow_edge_event);
+		}
+
+	}
+
+}
+
+#endif
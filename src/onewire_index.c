@@ -0,0 +1,133 @@
+/**
+ * @file onewire_index.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Rom lookup by full rom or by family code and serial prefix. With
+ * OW_ROM_INDEX the slots of a context are kept sorted in search order
+ * and looked up with binary search. Slots themselves never move, so
+ * an index found once stays valid through rescans until the device
+ * is removed.
+ */
+
+#include <string.h>
+#include "onewire_bus.h"
+
+#ifdef OW_ROM_INDEX
+
+/**
+ * @fn static int8_t OwRomCompare(const uint8_t* a, const uint8_t* b, uint8_t len)
+ * @brief Compares roms in search order, which runs from the LSB of the family code up.
+ *
+ * @param a		first rom
+ * @param b		second rom or prefix
+ * @param len		number of bytes to compare
+ *
+ * @return		-1, 0 or 1 as a is before, equal to or after b
+ */
+static int8_t OwRomCompare(const uint8_t* a, const uint8_t* b, uint8_t len) {
+
+	uint8_t i;
+	uint8_t diff;
+
+	for(i = 0; i < len; i++) {
+
+		diff = a[i] ^ b[i];
+
+		if(diff) {
+
+			// lowest differing bit decides, search takes the zero branch first
+			return (a[i] & diff & -diff) ? 1 : -1;
+
+		}
+
+	}
+
+	return 0;
+
+}
+
+/**
+ * @fn void OwRomSort(OwContext* ctx)
+ * @brief Sorts the slots of a context by rom. Free slots left by a rescan have a zero rom and sort first.
+ *
+ * @param ctx		context holding the roms
+ */
+void OwRomSort(OwContext* ctx) {
+
+	uint8_t i;
+	uint8_t j;
+
+	for(i = 0; i < ctx->count; i++) {
+
+		// roms of a full search arrive sorted and each insert stops at once
+		for(j = i; j && OwRomCompare(ctx->roms[ctx->order[j - 1]], ctx->roms[i], 8) > 0; j--) {
+			ctx->order[j] = ctx->order[j - 1];
+		}
+
+		ctx->order[j] = i;
+
+	}
+
+}
+
+#endif
+
+/**
+ * @fn uint8_t OwRomFind(OwContext* ctx, const uint8_t* prefix, uint8_t len)
+ * @brief Finds a rom by its first bytes, family code followed by serial number. With OW_ROM_INDEX the first match in search order is found with binary search, otherwise the lowest matching index with a linear scan.
+ *
+ * @param ctx		context holding the roms
+ * @param prefix	family code and serial bytes
+ * @param len		number of bytes in prefix, 1 to 8
+ *
+ * @return		index of the rom or OW_ROM_NOT_FOUND
+ */
+uint8_t OwRomFind(OwContext* ctx, const uint8_t* prefix, uint8_t len) {
+
+	uint8_t low = 0;
+	uint8_t high = ctx->count;
+	#ifdef OW_ROM_INDEX
+		uint8_t mid;
+	#endif
+
+	// free slots have a zero family code
+	if(!prefix[0]) {
+		return OW_ROM_NOT_FOUND;
+	}
+
+	#ifdef OW_ROM_INDEX
+
+		while(low < high) {
+
+			mid = low + ((high - low) >> 1);
+
+			if(OwRomCompare(ctx->roms[ctx->order[mid]], prefix, len) < 0) {
+				low = mid + 1;
+			} else {
+				high = mid;
+			}
+
+		}
+
+		if(low < ctx->count && !OwRomCompare(ctx->roms[ctx->order[low]], prefix, len)) {
+			return ctx->order[low];
+		}
+
+	#else
+
+		for(; low < high; low++) {
+
+			if(!memcmp(ctx->roms[low], prefix, len)) {
+				return low;
+			}
+
+		}
+
+	#endif
+
+	return OW_ROM_NOT_FOUND;
+
+}
@@ -0,0 +1,312 @@
+/**
+ * @file onewire_parallel.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Parallel slot engine for several buses on the same port. One write to
+ * the direction register starts a slot on every bus and one read of the
+ * pin register samples all of them, so eight buses take the bus time of
+ * one. Each bus gets its own data bit in every slot. Bytes are given and
+ * returned as arrays indexed by pin number.
+ */
+
+#include "onewire_bus.h"
+
+#ifdef OW_PARALLEL
+
+/**
+ * @def OW_PARALLEL_BUS_CYCLES
+ *
+ * Cycles spent in OwParallelLow() or OwParallelHigh(). Ports are
+ * reached through the bus pointers as with OW_MULTI_BUS.
+ */
+#ifndef OW_PARALLEL_BUS_CYCLES
+	#ifdef OW_INTERNAL_PULLUP
+		#define OW_PARALLEL_BUS_CYCLES	20
+	#else
+		#define OW_PARALLEL_BUS_CYCLES	10
+	#endif
+#endif
+
+/**
+ * @def OW_PARALLEL_SAMPLE_CYCLES
+ *
+ * Cycles spent sampling the pins of all buses.
+ */
+#ifndef OW_PARALLEL_SAMPLE_CYCLES
+	#define OW_PARALLEL_SAMPLE_CYCLES	9
+#endif
+
+/**
+ * @fn static inline void OwParallelLow(const OwParallelBus* bus, uint8_t mask)
+ * @brief Drives given pins low.
+ *
+ * @param bus		port of the buses
+ * @param mask		pins to drive
+ */
+static inline void OwParallelLow(const OwParallelBus* bus, uint8_t mask) {
+
+	*bus->direction |= mask;
+	#ifdef OW_INTERNAL_PULLUP
+		*bus->port &= ~mask;
+	#endif
+
+}
+
+/**
+ * @fn static inline void OwParallelHigh(const OwParallelBus* bus, uint8_t mask)
+ * @brief Releases given pins.
+ *
+ * @param bus		port of the buses
+ * @param mask		pins to release
+ */
+static inline void OwParallelHigh(const OwParallelBus* bus, uint8_t mask) {
+
+	*bus->direction &= ~mask;
+	#ifdef OW_INTERNAL_PULLUP
+		*bus->port |= mask;
+	#endif
+
+}
+
+/**
+ * @fn static inline void OwParallelWriteSlot(const OwParallelBus* bus, uint8_t ones)
+ * @brief Writes a bit to every bus. Buses in ones get a one bit, the rest a zero bit.
+ *
+ * @param bus		port of the buses
+ * @param ones		pins writing a one
+ */
+static inline void OwParallelWriteSlot(const OwParallelBus* bus, uint8_t ones) {
+
+	#if defined(OW_BLOCK_INTERRUPTS_BITLEVEL) || defined(OW_BLOCK_INTERRUPTS_SAMPLE)
+		cli();
+	#endif
+
+	OwParallelLow(bus, bus->mask);
+	OwDelay(OW_SHORT_DELAY, OW_PARALLEL_BUS_CYCLES);
+
+	// one bits are released after the short delay, zero bits after the long one
+	OwParallelHigh(bus, ones & bus->mask);
+
+	#ifdef OW_BLOCK_INTERRUPTS_SAMPLE
+		sei();
+	#endif
+
+	OwDelay(OW_LONG_DELAY - OW_SHORT_DELAY, OW_PARALLEL_BUS_CYCLES);
+
+	OwParallelHigh(bus, bus->mask);
+	OwDelay(OW_SHORT_DELAY, OW_LOOP_CYCLES + OW_PARALLEL_BUS_CYCLES);
+
+	#ifdef OW_BLOCK_INTERRUPTS_BITLEVEL
+		sei();
+	#endif
+
+}
+
+/**
+ * @fn static inline uint8_t OwParallelReadSlot(const OwParallelBus* bus)
+ * @brief Reads a bit from every bus.
+ *
+ * @param bus		port of the buses
+ *
+ * @return pins which read a one
+ */
+static inline uint8_t OwParallelReadSlot(const OwParallelBus* bus) {
+
+	uint8_t bits;
+
+	#if defined(OW_BLOCK_INTERRUPTS_BITLEVEL) || defined(OW_BLOCK_INTERRUPTS_SAMPLE)
+		cli();
+	#endif
+
+	OwParallelLow(bus, bus->mask);
+	OwDelay(OW_SHORT_DELAY, OW_PARALLEL_BUS_CYCLES);
+
+	OwParallelHigh(bus, bus->mask);
+	OwDelay(OW_SAMPLE_DELAY, OW_PARALLEL_SAMPLE_CYCLES);
+
+	bits = *bus->pin & bus->mask;
+
+	#ifdef OW_BLOCK_INTERRUPTS_SAMPLE
+		sei();
+	#endif
+
+	OwDelay(OW_LONG_DELAY - OW_SAMPLE_DELAY, OW_PARALLEL_SAMPLE_CYCLES + OW_LOOP_CYCLES + OW_PARALLEL_BUS_CYCLES);
+
+	#ifdef OW_BLOCK_INTERRUPTS_BITLEVEL
+		sei();
+	#endif
+
+	return bits;
+
+}
+
+/**
+ * @fn void OwParallelInit(const OwParallelBus* bus)
+ * @brief Initializes the buses.
+ *
+ * @param bus		port of the buses
+ */
+void OwParallelInit(const OwParallelBus* bus) {
+
+	OwParallelHigh(bus, bus->mask);
+	*bus->port &= ~bus->mask;
+
+}
+
+/**
+ * @fn uint8_t OwParallelReset(const OwParallelBus* bus)
+ * @brief Writes reset pulse to every bus at once and checks for presence pulses.
+ *
+ * @param bus		port of the buses
+ *
+ * @return pins of the buses with presence pulse
+ */
+uint8_t OwParallelReset(const OwParallelBus* bus) {
+
+	uint8_t presence;
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		cli();
+	#endif
+
+	OwParallelLow(bus, bus->mask);
+	OwDelay(OW_RESET_DELAY, OW_PARALLEL_BUS_CYCLES);
+
+	#if defined(OW_BLOCK_INTERRUPTS_BITLEVEL) || defined(OW_BLOCK_INTERRUPTS_SAMPLE)
+		cli();
+	#endif
+
+	OwParallelHigh(bus, bus->mask);
+	OwDelay(OW_LONG_DELAY, OW_PARALLEL_SAMPLE_CYCLES);
+
+	// presence pulse pulls the bus low
+	presence = ~*bus->pin & bus->mask;
+
+	#if defined(OW_BLOCK_INTERRUPTS_BITLEVEL) || defined(OW_BLOCK_INTERRUPTS_SAMPLE)
+		sei();
+	#endif
+
+	OwDelay(OW_RESET_DELAY - OW_LONG_DELAY, OW_PARALLEL_BUS_CYCLES);
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		sei();
+	#endif
+
+	return presence;
+
+}
+
+/**
+ * @fn void OwParallelWriteByte(const OwParallelBus* bus, const uint8_t* data)
+ * @brief Writes a byte to every bus. Slot masks are computed before the first slot so nothing but the slots themselves is timed.
+ *
+ * @param bus		port of the buses
+ * @param data		8 bytes indexed by pin number, entries of pins outside the mask are ignored
+ */
+void OwParallelWriteByte(const OwParallelBus* bus, const uint8_t* data) {
+
+	uint8_t slots[8];
+	uint8_t i, pin;
+
+	// transpose: slot i carries bit i of every bus
+	for(i = 0; i < 8; i++) {
+
+		slots[i] = 0;
+
+		for(pin = 0; pin < 8; pin++) {
+
+			if(data[pin] & (1 << i)) {
+				slots[i] |= 1 << pin;
+			}
+
+		}
+
+	}
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		cli();
+	#endif
+
+	for(i = 0; i < 8; i++) {
+		OwParallelWriteSlot(bus, slots[i]);
+	}
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		sei();
+	#endif
+
+}
+
+/**
+ * @fn void OwParallelWriteByteAll(const OwParallelBus* bus, uint8_t data)
+ * @brief Writes the same byte to every bus, e.g. Skip rom and Convert T.
+ *
+ * @param bus		port of the buses
+ * @param data		byte to be written
+ */
+void OwParallelWriteByteAll(const OwParallelBus* bus, uint8_t data) {
+
+	uint8_t i;
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		cli();
+	#endif
+
+	for(i = 0; i < 8; i++) {
+
+		OwParallelWriteSlot(bus, (data & 1) ? 0xFF : 0x00);
+		data >>= 1;
+
+	}
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		sei();
+	#endif
+
+}
+
+/**
+ * @fn void OwParallelReadByte(const OwParallelBus* bus, uint8_t* data)
+ * @brief Reads a byte from every bus.
+ *
+ * @param bus		port of the buses
+ * @param data		8 bytes indexed by pin number, entries of pins outside the mask are set to 0xFF
+ */
+void OwParallelReadByte(const OwParallelBus* bus, uint8_t* data) {
+
+	uint8_t slots[8];
+	uint8_t i, pin;
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		cli();
+	#endif
+
+	for(i = 0; i < 8; i++) {
+		slots[i] = OwParallelReadSlot(bus);
+	}
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		sei();
+	#endif
+
+	// transpose back: byte of each bus is collected from the slots
+	for(pin = 0; pin < 8; pin++) {
+
+		data[pin] = 0;
+
+		for(i = 0; i < 8; i++) {
+
+			if((slots[i] | ~bus->mask) & (1 << pin)) {
+				data[pin] |= 1 << i;
+			}
+
+		}
+
+	}
+
+}
+
+#endif
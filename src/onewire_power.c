@@ -0,0 +1,141 @@
+/**
+ * @file onewire_power.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Strong pull-up for parasite powered devices. The bus pin is driven
+ * high as an output right after the last bit of Convert T or Copy
+ * scratchpad and released from a Timer2 compare match interrupt with
+ * a period of one millisecond, so the application keeps running while
+ * the bus is powered.
+ */
+
+#include "onewire_bus.h"
+
+#ifdef OW_STRONG_PULLUP
+
+#if OW_POWER_PRESCALER == 64
+	#define OW_POWER_CS		(1 << CS22)
+#elif OW_POWER_PRESCALER == 128
+	#define OW_POWER_CS		((1 << CS22) | (1 << CS20))
+#elif OW_POWER_PRESCALER == 256
+	#define OW_POWER_CS		((1 << CS22) | (1 << CS21))
+#else
+	#error "OW_POWER_PRESCALER must be 64, 128 or 256"
+#endif
+
+/**
+ * @def OW_POWER_TICKS
+ *
+ * Timer2 compare value of one millisecond. CTC period is OCR2A + 1.
+ */
+#define OW_POWER_TICKS			(F_CPU / (OW_POWER_PRESCALER * 1000UL) - 1)
+
+#if OW_POWER_TICKS > 0xFF
+	#error "One millisecond does not fit in Timer2 with OW_POWER_PRESCALER"
+#endif
+
+// milliseconds left, only touched by the interrupt while powered
+static volatile uint16_t ow_power_ms;
+// set while the bus is driven high
+volatile uint8_t ow_power_on;
+
+#ifdef OW_MULTI_BUS
+// bus driven high, the selected bus may change while powered
+static OwBus* ow_power_bus;
+#endif
+
+/**
+ * @fn static inline void OwPowerOff(void)
+ * @brief Stops the timer and returns the powered bus to open-drain operation.
+ */
+static inline void OwPowerOff(void) {
+
+	TCCR2B = 0;
+	TIMSK2 &= ~(1 << OCIE2A);
+
+	#ifdef OW_MULTI_BUS
+		*ow_power_bus->direction &= ~ow_power_bus->mask;
+		#ifndef OW_INTERNAL_PULLUP
+			*ow_power_bus->port &= ~ow_power_bus->mask;
+		#endif
+	#else
+		OW_DIRECTION &= ~(1 << OW_BIT);
+		#ifndef OW_INTERNAL_PULLUP
+			OW_PORT &= ~(1 << OW_BIT);
+		#endif
+	#endif
+
+	ow_power_on = 0;
+
+}
+
+/**
+ * @fn void OwPowerStart(uint16_t ms)
+ * @brief Drives the selected bus high and starts the timer which releases it after given time. Called right after the last bit of a byte.
+ *
+ * @param ms		time to keep the bus powered in milliseconds
+ */
+void OwPowerStart(uint16_t ms) {
+
+	// port first so switching to output never drives low
+	OW_BUS_PORT |= OW_BUS_MASK;
+	OW_BUS_DIRECTION |= OW_BUS_MASK;
+
+	#ifdef OW_MULTI_BUS
+		ow_power_bus = ow_bus;
+	#endif
+
+	ow_power_ms = ms;
+	ow_power_on = 1;
+
+	TCCR2A = 1 << WGM21;
+	TCNT2 = 0;
+	OCR2A = OW_POWER_TICKS;
+	TIFR2 = 1 << OCF2A;
+	TIMSK2 |= 1 << OCIE2A;
+	TCCR2B = OW_POWER_CS;
+
+}
+
+/**
+ * @fn uint8_t OwPowerActive(void)
+ * @brief Checks whether the bus is powered by the strong pull-up.
+ *
+ * @return		0x01 while the bus is powered, otherwise 0x00.
+ */
+uint8_t OwPowerActive(void) {
+
+	return ow_power_on;
+
+}
+
+/**
+ * @fn void OwPowerRelease(void)
+ * @brief Releases the strong pull-up before its time has passed.
+ */
+void OwPowerRelease(void) {
+
+	uint8_t sreg = SREG;
+
+	cli();
+
+	if(ow_power_on) {
+		OwPowerOff();
+	}
+
+	SREG = sreg;
+
+}
+
+ISR(TIMER2_COMPA_vect) {
+
+	if(!--ow_power_ms) {
+		OwPowerOff();
+	}
+
+}
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * @file onewire_rom.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Packed rom tables. Roms of a single family are stored as 6-byte
+ * serial numbers, the family code once per table and the crc byte is
+ * recomputed when the rom is needed.
+ */
+
+#include <string.h>
+#include "onewire_bus.h"
+
+/**
+ * @fn void OwPackedInit(OwPackedTable* table, uint8_t family, uint8_t (*serials)[6], uint8_t capacity)
+ * @brief Initializes an empty packed table.
+ *
+ * @param table		table to initialize
+ * @param family	family code of the roms
+ * @param serials	buffer for the serial numbers
+ * @param capacity	number of serials fitting in the buffer
+ */
+void OwPackedInit(OwPackedTable* table, uint8_t family, uint8_t (*serials)[6], uint8_t capacity) {
+
+	table->family = family;
+	table->serials = serials;
+	table->capacity = capacity;
+	table->count = 0;
+
+}
+
+/**
+ * @fn uint8_t OwPackedSearch(OwContext* ctx, OwPackedTable* table)
+ * @brief Searches devices of the table family and stores their serial numbers. Search state of the context is used, roms of the context are not touched.
+ *
+ * @param ctx		context holding the search state and bus
+ * @param table		table for the serials
+ *
+ * @return number of serials stored
+ */
+uint8_t OwPackedSearch(OwContext* ctx, OwPackedTable* table) {
+
+	uint8_t found;
+	uint8_t i = 0;
+
+	found = OwSearchFamilyFirst(ctx, table->family);
+
+	while(found && i < table->capacity) {
+
+		// family code and crc are dropped
+		memcpy(table->serials[i], &ctx->search.rom[1], 6);
+
+		if(++i == table->capacity) {
+			break;
+		}
+
+		found = OwSearchFamilyNext(ctx);
+
+	}
+
+	table->count = i;
+
+	return i;
+
+}
+
+/**
+ * @fn void OwPackedRom(const OwPackedTable* table, uint8_t index, uint8_t* rom)
+ * @brief Unpacks a rom with family code and crc.
+ *
+ * @param table		table holding the serial
+ * @param index		index of the serial
+ * @param rom		buffer for the 8-byte rom
+ */
+void OwPackedRom(const OwPackedTable* table, uint8_t index, uint8_t* rom) {
+
+	rom[0] = table->family;
+	memcpy(&rom[1], table->serials[index], 6);
+	rom[7] = OwCrc8(rom, 7);
+
+}
+
+/**
+ * @fn uint8_t OwPackedIndex(const OwPackedTable* table, const uint8_t* rom)
+ * @brief Finds the index of a rom in a packed table.
+ *
+ * @param table		table holding the serials
+ * @param rom		8-byte rom to look for
+ *
+ * @return		index of the rom or OW_ROM_NOT_FOUND
+ */
+uint8_t OwPackedIndex(const OwPackedTable* table, const uint8_t* rom) {
+
+	uint8_t i;
+
+	if(rom[0] != table->family) {
+		return OW_ROM_NOT_FOUND;
+	}
+
+	for(i = 0; i < table->count; i++) {
+
+		if(!memcmp(table->serials[i], &rom[1], 6)) {
+			return i;
+		}
+
+	}
+
+	return OW_ROM_NOT_FOUND;
+
+}
@@ -0,0 +1,199 @@
+/**
+ * @file onewire_scan.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Rescan for buses with devices attached and removed at runtime. A
+ * rescan still enumerates the whole bus with one search pass per
+ * present device, known or not. An unknown device may share any
+ * prefix with known ones, so no branch can be skipped. What is
+ * incremental is the result: each step runs one pass so a rescan can
+ * be spread over the main loop, changes are reported as deltas
+ * against the rom table of the context and indices of present
+ * devices never move.
+ */
+
+#include <string.h>
+#include "onewire_bus.h"
+
+/**
+ * @fn static uint8_t OwScanAdd(OwContext* ctx)
+ * @brief Stores the rom in search state into the first free slot of the context.
+ *
+ * @param ctx		context holding the roms
+ *
+ * @return		index of the slot or OW_ROM_NOT_FOUND if the context is full
+ */
+static uint8_t OwScanAdd(OwContext* ctx) {
+
+	uint8_t i;
+
+	for(i = 0; i < ctx->count; i++) {
+
+		// removed devices leave a zero family code
+		if(!ctx->roms[i][0]) {
+			break;
+		}
+
+	}
+
+	if(i == ctx->count) {
+
+		if(i == OW_CTX_CAPACITY(ctx) || i == OW_MAX_ROMS) {
+			return OW_ROM_NOT_FOUND;
+		}
+
+		ctx->count++;
+
+	}
+
+	memcpy(ctx->roms[i], ctx->search.rom, 8);
+	ctx->resolution[i] = 0;
+	OW_CTX_SINGLE(ctx, 0);
+	OW_ROM_SORT(ctx);
+
+	return i;
+
+}
+
+/**
+ * @fn static void OwScanFinish(OwContext* ctx, OwScanState* scan, OwChangeCallback changed)
+ * @brief Removes the devices which were not seen during the rescan.
+ *
+ * @param ctx		context holding the roms
+ * @param scan		rescan state
+ * @param changed	called for each removed device, may be 0
+ */
+static void OwScanFinish(OwContext* ctx, OwScanState* scan, OwChangeCallback changed) {
+
+	uint8_t i;
+
+	for(i = 0; i < ctx->count; i++) {
+
+		if(ctx->roms[i][0] && !(scan->seen[i >> 3] & (1 << (i & 7)))) {
+
+			if(changed) {
+				changed(ctx, i, 0);
+			}
+
+			memset(ctx->roms[i], 0, 8);
+			scan->changes++;
+
+		}
+
+	}
+
+	// trailing free slots are dropped
+	while(ctx->count && !ctx->roms[ctx->count - 1][0]) {
+		ctx->count--;
+	}
+
+	OW_ROM_SORT(ctx);
+	scan->active = 0;
+
+}
+
+/**
+ * @fn uint8_t OwRescanStep(OwContext* ctx, OwScanState* scan, OwChangeCallback changed)
+ * @brief Runs one search pass of a rescan. Unknown devices are added to free slots as they are found, devices not seen during the whole rescan are removed after the last pass. Removed slots are zeroed and reused by later additions. Search state of the context is used, other searches must not be run on it before the rescan has finished. A bus fault in the middle of a rescan ends it without removing devices.
+ *
+ * @param ctx		context holding the roms
+ * @param scan		rescan state, zeroed before the first step
+ * @param changed	called for each added or removed device, may be 0
+ *
+ * @return		0x01 while the rescan continues, 0x00 after the last pass.
+ */
+uint8_t OwRescanStep(OwContext* ctx, OwScanState* scan, OwChangeCallback changed) {
+
+	uint8_t found;
+	uint8_t rom;
+
+	if(!scan->active) {
+
+		memset(scan->seen, 0, sizeof(scan->seen));
+		scan->changes = 0;
+		scan->active = 1;
+
+		found = OwSearchFirst(ctx);
+
+		if(!found) {
+
+			// nothing answered, every device is gone
+			if(ctx->search.status == OW_ERR_NO_PRESENCE) {
+				OwScanFinish(ctx, scan, changed);
+			} else {
+				scan->active = 0;
+			}
+
+			return 0;
+
+		}
+
+	} else {
+
+		found = OwSearchNext(ctx);
+
+		// bus fault, wait for the next rescan
+		if(!found) {
+
+			scan->active = 0;
+			return 0;
+
+		}
+
+	}
+
+	rom = OwRomIndex(ctx, ctx->search.rom);
+
+	if(rom == OW_ROM_NOT_FOUND) {
+
+		rom = OwScanAdd(ctx);
+
+		if(rom != OW_ROM_NOT_FOUND) {
+
+			if(changed) {
+				changed(ctx, rom, 1);
+			}
+
+			scan->changes++;
+
+		}
+
+	}
+
+	if(rom != OW_ROM_NOT_FOUND) {
+		scan->seen[rom >> 3] |= 1 << (rom & 7);
+	}
+
+	if(ctx->search.last_device) {
+
+		OwScanFinish(ctx, scan, changed);
+		return 0;
+
+	}
+
+	return 1;
+
+}
+
+/**
+ * @fn uint8_t OwRescan(OwContext* ctx, OwScanState* scan, OwChangeCallback changed)
+ * @brief Runs a whole rescan.
+ *
+ * @param ctx		context holding the roms
+ * @param scan		rescan state
+ * @param changed	called for each added or removed device, may be 0
+ *
+ * @return number of devices added or removed
+ */
+uint8_t OwRescan(OwContext* ctx, OwScanState* scan, OwChangeCallback changed) {
+
+	scan->active = 0;
+
+	while(OwRescanStep(ctx, scan, changed));
+
+	return scan->changes;
+
+}
@@ -0,0 +1,757 @@
+/**
+ * @file onewire_sim.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Simulated bus for host builds. The library drives a virtual pin,
+ * delays advance a virtual clock and the slaves decode reset pulses
+ * and slots from the edges of the pin like real devices do. DS18B20
+ * and DS2431 function commands are simulated, other families answer
+ * rom commands only.
+ */
+
+#include <string.h>
+#include "onewire_bus.h"
+
+#ifdef OW_SIM
+
+/**
+ * @def OW_SIM_IDLE
+ *
+ * Slave states. An idle slave waits for the next reset.
+ */
+#define OW_SIM_IDLE			0
+#define OW_SIM_ROM			1
+#define OW_SIM_SEARCH			2
+#define OW_SIM_MATCH			3
+#define OW_SIM_FUNCTION			4
+#define OW_SIM_RX			5
+#define OW_SIM_TX			6
+#define OW_SIM_BUSY			7
+
+/**
+ * @def OW_SIM_RESET
+ *
+ * Shortest low time taken as reset pulse at standard and
+ * overdrive speed.
+ */
+#define OW_SIM_RESET			400
+#define OW_SIM_OD_RESET			48
+
+/**
+ * @def OW_SIM_ONE
+ *
+ * Low time under which a slot is written as one at standard
+ * and overdrive speed.
+ */
+#define OW_SIM_ONE			15
+#define OW_SIM_OD_ONE			2
+
+/**
+ * @def OW_SIM_HOLD
+ *
+ * Time a slave holds the bus low for a zero bit at standard and
+ * overdrive speed.
+ */
+#define OW_SIM_HOLD			30
+#define OW_SIM_OD_HOLD			3
+
+OwSimDevice ow_sim_devices[OW_SIM_DEVICES];
+uint8_t ow_sim_count;
+
+volatile uint8_t ow_sim_port;
+volatile uint8_t ow_sim_direction;
+uint8_t ow_sim_sreg;
+
+static double ow_sim_now;
+static double ow_sim_fall;
+static double ow_sim_start;
+static uint8_t ow_sim_low;
+static uint8_t ow_sim_shorted;
+static OwSimCounters ow_sim_counters;
+
+/**
+ * @fn static uint8_t OwSimCrc8(const uint8_t* data, uint8_t len)
+ * @brief Bitwise Dallas crc8, kept apart from the library crc so that both are checked against each other.
+ *
+ * @param data		bytes to check
+ * @param len		number of bytes
+ *
+ * @return		crc8 of the bytes
+ */
+static uint8_t OwSimCrc8(const uint8_t* data, uint8_t len) {
+
+	uint8_t crc = 0;
+	uint8_t i;
+
+	while(len--) {
+
+		crc ^= *data++;
+
+		for(i = 0; i < 8; i++) {
+			crc = crc & 0x01 ? (crc >> 1) ^ 0x8C : crc >> 1;
+		}
+
+	}
+
+	return crc;
+
+}
+
+/**
+ * @fn static uint16_t OwSimCrc16(uint16_t crc, const uint8_t* data, uint8_t len)
+ * @brief Bitwise crc16 of DS24xx memory commands.
+ *
+ * @param crc		crc of the preceding bytes
+ * @param data		bytes to add
+ * @param len		number of bytes
+ *
+ * @return		updated crc16
+ */
+static uint16_t OwSimCrc16(uint16_t crc, const uint8_t* data, uint8_t len) {
+
+	uint8_t i;
+
+	while(len--) {
+
+		crc ^= *data++;
+
+		for(i = 0; i < 8; i++) {
+			crc = crc & 0x01 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+		}
+
+	}
+
+	return crc;
+
+}
+
+/**
+ * @fn static uint8_t OwSimRomBit(OwSimDevice* dev)
+ * @brief Gives the rom bit at the bit position of a slave.
+ *
+ * @param dev		slave
+ *
+ * @return		rom bit
+ */
+static uint8_t OwSimRomBit(OwSimDevice* dev) {
+
+	return (dev->rom[dev->bit >> 3] >> (dev->bit & 7)) & 0x01;
+
+}
+
+/**
+ * @fn static void OwSimSend(OwSimDevice* dev, const uint8_t* data, uint16_t len)
+ * @brief Starts sending bytes in the following read slots. Ones are sent after the last byte.
+ *
+ * @param dev		slave
+ * @param data		bytes to send, kept until sent
+ * @param len		number of bytes
+ */
+static void OwSimSend(OwSimDevice* dev, const uint8_t* data, uint16_t len) {
+
+	dev->tx = data;
+	dev->tx_bits = len * 8;
+	dev->tx_pos = 0;
+	dev->state = OW_SIM_TX;
+
+}
+
+/**
+ * @fn static void OwSimConvert(OwSimDevice* dev)
+ * @brief Runs a DS18B20 conversion with the resolution of the configuration register.
+ *
+ * @param dev		slave
+ */
+static void OwSimConvert(OwSimDevice* dev) {
+
+	uint8_t bits = 9 + ((dev->scratchpad[4] >> 5) & 0x03);
+	int16_t value = dev->temperature & ~((1 << (12 - bits)) - 1);
+	int8_t whole = value >> 4;
+
+	dev->scratchpad[0] = value;
+	dev->scratchpad[1] = value >> 8;
+	dev->scratchpad[8] = OwSimCrc8(dev->scratchpad, 8);
+
+	dev->alarm = whole >= (int8_t)dev->scratchpad[2] || whole <= (int8_t)dev->scratchpad[3];
+
+	// 750 ms at 12 bits, halved for each bit less
+	dev->busy_until = ow_sim_now + 750000.0 / (1 << (12 - bits));
+	dev->state = OW_SIM_BUSY;
+
+}
+
+/**
+ * @fn static void OwSimDs18b20(OwSimDevice* dev, uint8_t data)
+ * @brief DS18B20 function commands and their data bytes.
+ *
+ * @param dev		slave
+ * @param data		received byte
+ */
+static void OwSimDs18b20(OwSimDevice* dev, uint8_t data) {
+
+	if(dev->state == OW_SIM_RX) {
+
+		// Write scratchpad: TH, TL and configuration
+		if(dev->rx_count < 3) {
+			dev->scratchpad[2 + dev->rx_count++] = data;
+			dev->scratchpad[8] = OwSimCrc8(dev->scratchpad, 8);
+		}
+
+		return;
+
+	}
+
+	switch(data) {
+
+		case OW_CONVERT_T:
+			OwSimConvert(dev);
+			break;
+
+		case OW_READ_SCRATCHPAD:
+			OwSimSend(dev, dev->scratchpad, 9);
+			break;
+
+		case OW_WRITE_SCRATCHPAD:
+			dev->state = OW_SIM_RX;
+			break;
+
+		case OW_COPY_SCRATCHPAD:
+			memcpy(dev->eeprom, &dev->scratchpad[2], 3);
+			dev->busy_until = ow_sim_now + 10000;
+			dev->state = OW_SIM_BUSY;
+			break;
+
+		case 0xB8:
+			// Recall E2
+			memcpy(&dev->scratchpad[2], dev->eeprom, 3);
+			dev->scratchpad[8] = OwSimCrc8(dev->scratchpad, 8);
+			dev->busy_until = ow_sim_now;
+			dev->state = OW_SIM_BUSY;
+			break;
+
+		default:
+			// Read power supply answers with ones, externally powered
+			dev->state = OW_SIM_IDLE;
+
+	}
+
+}
+
+/**
+ * @fn static void OwSimDs2431(OwSimDevice* dev, uint8_t data)
+ * @brief DS2431 memory function commands and their data bytes. Programming time of Copy scratchpad is not simulated.
+ *
+ * @param dev		slave
+ * @param data		received byte
+ */
+static void OwSimDs2431(OwSimDevice* dev, uint8_t data) {
+
+	uint8_t n;
+	uint8_t offset;
+	uint16_t address;
+	uint16_t crc;
+
+	if(dev->state != OW_SIM_RX) {
+
+		dev->command = data;
+		dev->rx_count = 0;
+
+		if(data == 0xAA) {
+
+			// Read scratchpad: TA1, TA2, E/S, data from T2:T0 to E2:E0 and inverted crc16
+			offset = dev->address[0] & 0x07;
+			n = (dev->address[2] & 0x07) >= offset ? (dev->address[2] & 0x07) + 1 - offset : 0;
+
+			dev->out[0] = data;
+			memcpy(&dev->out[1], dev->address, 3);
+			memcpy(&dev->out[4], &dev->scratchpad[offset], n);
+			crc = ~OwSimCrc16(0, dev->out, 4 + n);
+			dev->out[4 + n] = crc;
+			dev->out[5 + n] = crc >> 8;
+
+			OwSimSend(dev, &dev->out[1], 5 + n);
+
+		} else if(data == 0x0F || data == 0x55 || data == 0xF0) {
+			dev->state = OW_SIM_RX;
+		} else {
+			dev->state = OW_SIM_IDLE;
+		}
+
+		return;
+
+	}
+
+	n = dev->rx_count++;
+
+	if(n < 2 && dev->command != 0x55) {
+
+		dev->address[n] = data;
+
+		// Read memory starts right after the target address
+		if(n == 0 || dev->command != 0xF0) {
+			return;
+		}
+
+	}
+
+	address = dev->address[0] | (dev->address[1] << 8);
+
+	switch(dev->command) {
+
+		case 0x0F:
+			// Write scratchpad: data up to the end of the row, then inverted crc16
+			offset = (dev->address[0] & 0x07) + n - 2;
+			dev->scratchpad[offset] = data;
+			dev->address[2] = offset;
+
+			if(offset == 7) {
+
+				dev->out[0] = dev->command;
+				dev->out[1] = dev->address[0];
+				dev->out[2] = dev->address[1];
+				crc = OwSimCrc16(0, dev->out, 3);
+				crc = ~OwSimCrc16(crc, &dev->scratchpad[dev->address[0] & 0x07], 8 - (dev->address[0] & 0x07));
+				dev->out[0] = crc;
+				dev->out[1] = crc >> 8;
+
+				OwSimSend(dev, dev->out, 2);
+
+			}
+			break;
+
+		case 0x55:
+			// Copy scratchpad: authorization pattern TA1, TA2, E/S
+			if(data != dev->address[n]) {
+				dev->state = OW_SIM_IDLE;
+			} else if(n == 2) {
+
+				if(address < 0x80) {
+					memcpy(&dev->memory[address & ~0x07], dev->scratchpad, 8);
+				}
+
+				dev->address[2] |= 0x80;
+				memset(dev->out, 0xAA, sizeof(dev->out));
+
+				OwSimSend(dev, dev->out, sizeof(dev->out));
+
+			}
+			break;
+
+		case 0xF0:
+			// Read memory: from the target address to the end of memory
+			if(address < OW_SIM_MEMORY_SIZE) {
+				OwSimSend(dev, &dev->memory[address], OW_SIM_MEMORY_SIZE - address);
+			} else {
+				dev->state = OW_SIM_IDLE;
+			}
+			break;
+
+	}
+
+}
+
+/**
+ * @fn static void OwSimByte(OwSimDevice* dev, uint8_t data)
+ * @brief Handles a byte received by a slave.
+ *
+ * @param dev		slave
+ * @param data		received byte
+ */
+static void OwSimByte(OwSimDevice* dev, uint8_t data) {
+
+	uint8_t od = dev->rom[0] == OW_SIM_DS2431;
+
+	if(dev->state == OW_SIM_ROM) {
+
+		dev->bit = 0;
+		dev->sub = 0;
+
+		switch(data) {
+
+			case OW_SEARCH_ROM:
+				dev->state = OW_SIM_SEARCH;
+				break;
+
+			case OW_ALARM_SEARCH:
+				dev->state = dev->alarm ? OW_SIM_SEARCH : OW_SIM_IDLE;
+				break;
+
+			case OW_MATCH_ROM:
+				dev->state = OW_SIM_MATCH;
+				break;
+
+			case OW_SKIP_ROM:
+				dev->state = OW_SIM_FUNCTION;
+				break;
+
+			case OW_READ_ROM:
+				OwSimSend(dev, dev->rom, 8);
+				break;
+
+			case OW_OVERDRIVE_MATCH_ROM:
+				dev->overdrive = od;
+				dev->state = od ? OW_SIM_MATCH : OW_SIM_IDLE;
+				break;
+
+			case OW_OVERDRIVE_SKIP_ROM:
+				dev->overdrive = od;
+				dev->state = od ? OW_SIM_FUNCTION : OW_SIM_IDLE;
+				break;
+
+			default:
+				dev->state = OW_SIM_IDLE;
+
+		}
+
+		return;
+
+	}
+
+	if(dev->state == OW_SIM_FUNCTION) {
+		dev->command = data;
+		dev->rx_count = 0;
+	}
+
+	if(dev->rom[0] == OW_SIM_DS18B20) {
+		OwSimDs18b20(dev, data);
+	} else if(dev->rom[0] == OW_SIM_DS2431) {
+		OwSimDs2431(dev, data);
+	} else {
+		dev->state = OW_SIM_IDLE;
+	}
+
+}
+
+/**
+ * @fn static uint8_t OwSimOutput(OwSimDevice* dev)
+ * @brief Gives the bit a slave answers in the slot starting now.
+ *
+ * @param dev		slave
+ *
+ * @return		0x00 if the slave holds the bus low
+ */
+static uint8_t OwSimOutput(OwSimDevice* dev) {
+
+	switch(dev->state) {
+
+		case OW_SIM_TX:
+			if(dev->tx_pos < dev->tx_bits) {
+				return (dev->tx[dev->tx_pos >> 3] >> (dev->tx_pos & 7)) & 0x01;
+			}
+			return 0x01;
+
+		case OW_SIM_SEARCH:
+			// rom bit and its complement, then the direction from master
+			return dev->sub < 2 ? OwSimRomBit(dev) ^ dev->sub : 0x01;
+
+		case OW_SIM_BUSY:
+			return ow_sim_now >= dev->busy_until;
+
+		default:
+			return 0x01;
+
+	}
+
+}
+
+/**
+ * @fn static void OwSimSlot(OwSimDevice* dev, uint8_t data)
+ * @brief Advances a slave by a finished slot.
+ *
+ * @param dev		slave
+ * @param data		bit written by master, 0x01 for read slots
+ */
+static void OwSimSlot(OwSimDevice* dev, uint8_t data) {
+
+	switch(dev->state) {
+
+		case OW_SIM_ROM:
+		case OW_SIM_FUNCTION:
+		case OW_SIM_RX:
+			dev->rx |= data << dev->bit;
+			if(++dev->bit == 8) {
+				data = dev->rx;
+				dev->rx = 0;
+				dev->bit = 0;
+				OwSimByte(dev, data);
+			}
+			break;
+
+		case OW_SIM_SEARCH:
+			if(dev->sub < 2) {
+				dev->sub++;
+				break;
+			}
+			dev->sub = 0;
+			// direction bit is matched like Match rom
+			/* fall through */
+
+		case OW_SIM_MATCH:
+			if(data != OwSimRomBit(dev)) {
+				dev->state = OW_SIM_IDLE;
+			} else if(++dev->bit == 64) {
+				dev->bit = 0;
+				dev->state = OW_SIM_FUNCTION;
+			}
+			break;
+
+		case OW_SIM_TX:
+			if(dev->tx_pos < dev->tx_bits) {
+				dev->tx_pos++;
+			}
+			break;
+
+	}
+
+}
+
+/**
+ * @fn static void OwSimFall(void)
+ * @brief Master pulled the bus low. Slaves sending a zero start holding the bus.
+ */
+static void OwSimFall(void) {
+
+	uint8_t i;
+	OwSimDevice* dev;
+
+	for(i = 0; i < ow_sim_count; i++) {
+
+		dev = &ow_sim_devices[i];
+
+		if(dev->present && !OwSimOutput(dev)) {
+			dev->hold_from = ow_sim_now;
+			dev->hold_until = ow_sim_now + (dev->overdrive ? OW_SIM_OD_HOLD : OW_SIM_HOLD);
+		}
+
+	}
+
+}
+
+/**
+ * @fn static void OwSimRise(double low)
+ * @brief Master released the bus. The low time is decoded as reset pulse or slot by each slave at its own speed.
+ *
+ * @param low		low time in us
+ */
+static void OwSimRise(double low) {
+
+	uint8_t i;
+	uint8_t reset = 0;
+	OwSimDevice* dev;
+
+	for(i = 0; i < ow_sim_count; i++) {
+
+		dev = &ow_sim_devices[i];
+
+		if(!dev->present) {
+			continue;
+		}
+
+		if(low >= OW_SIM_RESET || (dev->overdrive && low >= OW_SIM_OD_RESET)) {
+
+			// standard speed reset returns slaves to standard speed
+			if(low >= OW_SIM_RESET) {
+				dev->overdrive = 0;
+			}
+
+			dev->state = OW_SIM_ROM;
+			dev->bit = 0;
+			dev->rx = 0;
+
+			// presence pulse
+			dev->hold_from = ow_sim_now + (dev->overdrive ? 2 : 20);
+			dev->hold_until = ow_sim_now + (dev->overdrive ? 10 : 140);
+
+			reset = 1;
+
+		} else {
+
+			OwSimSlot(dev, low < (dev->overdrive ? OW_SIM_OD_ONE : OW_SIM_ONE));
+
+		}
+
+	}
+
+	if(reset || low >= OW_SIM_RESET) {
+		ow_sim_counters.resets++;
+	} else {
+		ow_sim_counters.slots++;
+	}
+
+}
+
+/**
+ * @fn static void OwSimUpdate(void)
+ * @brief Detects edges written to the pin registers since the last call.
+ */
+static void OwSimUpdate(void) {
+
+	// driven low when output with port bit cleared
+	uint8_t low = (ow_sim_direction & 0x01) && !(ow_sim_port & 0x01);
+
+	if(low && !ow_sim_low) {
+		ow_sim_fall = ow_sim_now;
+		OwSimFall();
+	} else if(!low && ow_sim_low) {
+		OwSimRise(ow_sim_now - ow_sim_fall);
+	}
+
+	ow_sim_low = low;
+
+}
+
+/**
+ * @fn uint8_t OwSimPin(void)
+ * @brief Reads the simulated pin. Used through OW_BUS_PIN.
+ *
+ * @return		0x01 if the bus is high
+ */
+uint8_t OwSimPin(void) {
+
+	uint8_t i;
+	OwSimDevice* dev;
+
+	OwSimUpdate();
+
+	if(ow_sim_low || ow_sim_shorted) {
+		return 0x00;
+	}
+
+	for(i = 0; i < ow_sim_count; i++) {
+
+		dev = &ow_sim_devices[i];
+
+		if(dev->present && ow_sim_now >= dev->hold_from && ow_sim_now < dev->hold_until) {
+			return 0x00;
+		}
+
+	}
+
+	return 0x01;
+
+}
+
+/**
+ * @fn void OwSimDelay(double us)
+ * @brief Advances the virtual clock. Used through OwDelay().
+ *
+ * @param us		delay in us
+ */
+void OwSimDelay(double us) {
+
+	OwSimUpdate();
+	ow_sim_now += us;
+
+}
+
+/**
+ * @fn void OwSimInit(void)
+ * @brief Removes all slaves and resets the clock, pin and counters.
+ */
+void OwSimInit(void) {
+
+	ow_sim_count = 0;
+	ow_sim_now = 0;
+	ow_sim_port = 0;
+	ow_sim_direction = 0;
+	ow_sim_low = 0;
+	ow_sim_shorted = 0;
+
+	OwSimClear();
+
+}
+
+/**
+ * @fn uint8_t OwSimAdd(uint8_t family, uint64_t serial)
+ * @brief Attaches a slave to the simulated bus. DS18B20 starts with power-on scratchpad and a temperature of 25 C.
+ *
+ * @param family	family code
+ * @param serial	48-bit serial number
+ *
+ * @return		index of the slave in ow_sim_devices or OW_ROM_NOT_FOUND if the bus is full
+ */
+uint8_t OwSimAdd(uint8_t family, uint64_t serial) {
+
+	static const uint8_t scratchpad[8] = { 0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10 };
+
+	uint8_t i;
+	OwSimDevice* dev;
+
+	if(ow_sim_count == OW_SIM_DEVICES) {
+		return OW_ROM_NOT_FOUND;
+	}
+
+	dev = &ow_sim_devices[ow_sim_count];
+	memset(dev, 0, sizeof(OwSimDevice));
+
+	dev->rom[0] = family;
+	for(i = 0; i < 6; i++) {
+		dev->rom[1 + i] = serial >> (8 * i);
+	}
+	dev->rom[7] = OwSimCrc8(dev->rom, 7);
+
+	dev->present = 1;
+
+	if(family == OW_SIM_DS18B20) {
+		memcpy(dev->scratchpad, scratchpad, 8);
+		dev->scratchpad[8] = OwSimCrc8(dev->scratchpad, 8);
+		memcpy(dev->eeprom, &scratchpad[2], 3);
+		dev->temperature = 25 * 16;
+	}
+
+	return ow_sim_count++;
+
+}
+
+/**
+ * @fn void OwSimShort(uint8_t shorted)
+ * @brief Shorts the simulated bus to ground.
+ *
+ * @param shorted	0x01 to short, 0x00 to release
+ */
+void OwSimShort(uint8_t shorted) {
+
+	ow_sim_shorted = shorted;
+
+}
+
+/**
+ * @fn void OwSimClear(void)
+ * @brief Resets the counters.
+ */
+void OwSimClear(void) {
+
+	memset(&ow_sim_counters, 0, sizeof(ow_sim_counters));
+	ow_sim_start = ow_sim_now;
+
+}
+
+/**
+ * @fn void OwSimRead(OwSimCounters* counters)
+ * @brief Copies the counters. Difference of two copies gives the cost of the operations between them.
+ *
+ * @param counters	destination of the copy
+ */
+void OwSimRead(OwSimCounters* counters) {
+
+	*counters = ow_sim_counters;
+	counters->time = ow_sim_now - ow_sim_start;
+
+}
+
+/**
+ * @fn double OwSimTime(void)
+ * @brief Gives the virtual clock.
+ *
+ * @return		time since OwSimInit() in us
+ */
+double OwSimTime(void) {
+
+	return ow_sim_now;
+
+}
+
+#endif
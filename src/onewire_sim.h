@@ -0,0 +1,115 @@
+/**
+ * @file onewire_sim.h
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Simulated bus for host builds with OW_SIM. Replaces the AVR
+ * headers for the library sources and gives the host program a bus
+ * of virtual slaves with slot, reset and bus time counters.
+ */
+
+#ifndef ONEWIRE_SIM_H
+#define ONEWIRE_SIM_H
+
+#include <stdint.h>
+#include "onewire.h"
+
+/**
+ * @def OW_SIM_DEVICES
+ *
+ * Maximum number of virtual slaves on the simulated bus.
+ */
+#ifndef OW_SIM_DEVICES
+	#define OW_SIM_DEVICES		64
+#endif
+
+/**
+ * @def OW_SIM_DS18B20
+ *
+ * Family codes with a simulated function command set. Other
+ * families answer rom commands only.
+ */
+#define OW_SIM_DS18B20			0x28
+#define OW_SIM_DS2431			0x2D
+
+/**
+ * @def OW_SIM_MEMORY_SIZE
+ *
+ * DS2431 data memory and registers, 0x0000 to 0x008F.
+ */
+#define OW_SIM_MEMORY_SIZE		144
+
+/**
+ * @struct OwSimDevices
+ *
+ * Virtual slave. Fields below state can be changed by the host
+ * program between bus operations.
+ */
+typedef struct OwSimDevices {
+	uint8_t rom[8];
+	uint8_t present;
+	uint8_t overdrive;
+	uint8_t state;			// protocol state, internal
+	uint8_t command;		// function command being executed
+	uint8_t bit;			// bit position of the current byte or rom
+	uint8_t sub;			// search step of the current rom bit
+	uint8_t rx;			// byte being received
+	uint8_t rx_count;		// bytes received after the command
+	const uint8_t* tx;		// bytes being sent
+	uint16_t tx_bits;
+	uint16_t tx_pos;
+	uint8_t out[16];		// response buffer
+	double hold_from;		// bus held low by the slave
+	double hold_until;
+	double busy_until;		// conversion or copy in progress
+	int16_t temperature;		// DS18B20 next conversion result in 1/16 C
+	uint8_t alarm;			// DS18B20 alarm flag of the last conversion
+	uint8_t eeprom[3];		// DS18B20 TH, TL and configuration
+	uint8_t scratchpad[9];		// DS18B20 scratchpad or DS2431 row
+	uint8_t address[3];		// DS2431 TA1, TA2 and E/S
+	uint8_t memory[OW_SIM_MEMORY_SIZE];	// DS2431 memory
+} OwSimDevice;
+
+/**
+ * @struct OwSimCounterss
+ *
+ * Bus activity since OwSimClear().
+ */
+typedef struct OwSimCounterss {
+	uint32_t resets;
+	uint32_t slots;
+	double time;			// bus time in us
+} OwSimCounters;
+
+extern OwSimDevice ow_sim_devices[OW_SIM_DEVICES];
+extern uint8_t ow_sim_count;
+
+void OwSimInit(void);
+uint8_t OwSimAdd(uint8_t family, uint64_t serial);
+void OwSimShort(uint8_t shorted);
+void OwSimClear(void);
+void OwSimRead(OwSimCounters* counters);
+double OwSimTime(void);
+
+/*
+ * Library side of the backend. The bus registers and delays of
+ * onewire_bus.h are routed here when OW_SIM is defined.
+ */
+
+extern volatile uint8_t ow_sim_port;
+extern volatile uint8_t ow_sim_direction;
+extern uint8_t ow_sim_sreg;
+
+uint8_t OwSimPin(void);
+void OwSimDelay(double us);
+
+#define SREG				ow_sim_sreg
+#define cli()
+#define sei()
+
+#undef OW_STATS_CLOCK
+#define OW_STATS_CLOCK()		((uint16_t)OwSimTime())
+
+#endif
@@ -0,0 +1,136 @@
+/**
+ * @file onewire_sleep.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Sleep between bus events. The timer-driven engine waits for its
+ * interrupts in idle mode, long waits sleep in power-down and wake
+ * from the watchdog interrupt. The watchdog is taken by OwSleep() and
+ * left disabled afterwards.
+ */
+
+#include "onewire_bus.h"
+
+#ifdef OW_SLEEP
+
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+/**
+ * @def OW_SLEEP_STEPS
+ *
+ * Number of watchdog periods, 16 ms doubled for each step up
+ * to 8 s.
+ */
+#define OW_SLEEP_STEPS			10
+
+/**
+ * @fn void OwSleepIdle(void)
+ * @brief Sleeps in idle mode until the next interrupt. Called with interrupts disabled after checking the wake condition, so an interrupt between the check and the sleep cannot be missed. Returns with interrupts enabled.
+ */
+void OwSleepIdle(void) {
+
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sleep_enable();
+
+	// sleep instruction right after sei() is executed before any interrupt
+	sei();
+	sleep_cpu();
+
+	sleep_disable();
+
+}
+
+/**
+ * @fn static void OwSleepWatchdog(uint8_t step)
+ * @brief Sleeps one watchdog period in power-down mode.
+ *
+ * @param step		period of 16 ms << step
+ */
+static void OwSleepWatchdog(uint8_t step) {
+
+	// WDP3 is apart from the other prescaler bits
+	uint8_t prescaler = (step & 0x07) | ((step & 0x08) ? 1 << WDP3 : 0);
+
+	cli();
+
+	wdt_reset();
+	MCUSR &= ~(1 << WDRF);
+
+	// timed sequence, interrupt mode without system reset
+	WDTCSR = (1 << WDCE) | (1 << WDE);
+	WDTCSR = (1 << WDIE) | prescaler;
+
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+
+	cli();
+	WDTCSR = (1 << WDCE) | (1 << WDE);
+	WDTCSR = 0;
+	sei();
+
+}
+
+/**
+ * @fn uint16_t OwSleep(uint16_t ms)
+ * @brief Sleeps at least given time by the nominal watchdog periods. While the strong pull-up is on the MCU sleeps in idle mode until the pull-up is released, since its timer stops in power-down.
+ *
+ * @param ms		time to sleep
+ *
+ * @return		time slept in power-down in ms. Timers of the application are stopped in power-down, so the time has to be added to their ticks.
+ */
+uint16_t OwSleep(uint16_t ms) {
+
+	uint8_t step;
+	uint16_t slept = 0;
+
+	#ifdef OW_STRONG_PULLUP
+
+		if(ow_power_on) {
+
+			// Timer2 of the pull-up wakes the MCU every millisecond
+			for(;;) {
+
+				cli();
+
+				if(!ow_power_on) {
+					sei();
+					break;
+				}
+
+				OwSleepIdle();
+
+			}
+
+			return 0;
+
+		}
+
+	#endif
+
+	while(slept < ms) {
+
+		// longest period which fits, or the shortest one to cover the rest
+		for(step = OW_SLEEP_STEPS - 1; step && (16U << step) > (uint16_t)(ms - slept); step--);
+
+		OwSleepWatchdog(step);
+		slept += 16U << step;
+
+	}
+
+	return slept;
+
+}
+
+ISR(WDT_vect) {
+
+	// wake-up only
+
+}
+
+#endif
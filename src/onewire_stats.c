@@ -0,0 +1,117 @@
+/**
+ * @file onewire_stats.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Instrumentation counters and the trace ring buffer. The hooks in
+ * the bus code compile to nothing unless OW_STATS or OW_TRACE is
+ * defined.
+ */
+
+#include <string.h>
+#include "onewire_bus.h"
+
+#ifdef OW_STATS
+
+OwStats ow_stats;
+
+/**
+ * @fn void OwStatsRead(OwStats* stats)
+ * @brief Copies the counters. Interrupts are masked for the copy so the multi-byte counters stay consistent.
+ *
+ * @param stats		destination of the copy
+ */
+void OwStatsRead(OwStats* stats) {
+
+	uint8_t sreg = SREG;
+
+	cli();
+	*stats = ow_stats;
+	SREG = sreg;
+
+}
+
+/**
+ * @fn void OwStatsClear(void)
+ * @brief Resets all counters to zero.
+ */
+void OwStatsClear(void) {
+
+	uint8_t sreg = SREG;
+
+	cli();
+	memset(&ow_stats, 0, sizeof(ow_stats));
+	SREG = sreg;
+
+}
+
+#endif
+
+#ifdef OW_TRACE
+
+static OwTraceEntry ow_trace[OW_TRACE_SIZE];
+static uint8_t ow_trace_head;
+static uint8_t ow_trace_count;
+
+/**
+ * @fn void OwTraceAdd(uint8_t event, uint8_t data)
+ * @brief Appends an event to the trace. The oldest entry is overwritten when the buffer is full.
+ *
+ * @param event		OW_TRACE_* event
+ * @param data		event specific data
+ */
+void OwTraceAdd(uint8_t event, uint8_t data) {
+
+	OwTraceEntry* entry = &ow_trace[ow_trace_head];
+
+	entry->time = OW_STATS_CLOCK();
+	entry->event = event;
+	entry->data = data;
+
+	if(++ow_trace_head == OW_TRACE_SIZE) {
+		ow_trace_head = 0;
+	}
+
+	if(ow_trace_count < OW_TRACE_SIZE) {
+		ow_trace_count++;
+	}
+
+}
+
+/**
+ * @fn uint8_t OwTraceRead(OwTraceEntry* entries, uint8_t max)
+ * @brief Copies the trace oldest entry first. The trace is left intact.
+ *
+ * @param entries	destination of at least max entries
+ * @param max		maximum number of entries to copy
+ *
+ * @return		number of entries copied
+ */
+uint8_t OwTraceRead(OwTraceEntry* entries, uint8_t max) {
+
+	uint8_t i;
+	uint8_t pos;
+	uint8_t sreg = SREG;
+
+	cli();
+
+	if(max > ow_trace_count) {
+		max = ow_trace_count;
+	}
+
+	// skip the older entries that do not fit
+	pos = ow_trace_head + OW_TRACE_SIZE - max;
+
+	for(i = 0; i < max; i++) {
+		entries[i] = ow_trace[(pos + i) % OW_TRACE_SIZE];
+	}
+
+	SREG = sreg;
+
+	return max;
+
+}
+
+#endif
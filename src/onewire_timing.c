@@ -0,0 +1,186 @@
+/**
+ * @file onewire_timing.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Calibrated standard speed timing. Rise time of the released bus and
+ * the presence pulse window are measured with a polling loop right
+ * after a reset pulse, when devices expect no slots, and turned into
+ * sample points and recovery times of the bus.
+ */
+
+#include "onewire_bus.h"
+
+#ifdef OW_CALIBRATION
+
+/**
+ * @def OW_CAL_LOOP_CYCLES
+ *
+ * Cycles of one iteration of the measuring loops with a 16-bit
+ * counter.
+ */
+#ifndef OW_CAL_LOOP_CYCLES
+	#ifdef OW_MULTI_BUS
+		#define OW_CAL_LOOP_CYCLES	14
+	#else
+		#define OW_CAL_LOOP_CYCLES	9
+	#endif
+#endif
+
+/**
+ * @def OW_CAL_LIMIT
+ *
+ * Iterations of a measuring loop in one reset pulse length. The
+ * whole presence sequence ends well within it.
+ */
+#define OW_CAL_LIMIT			((uint16_t)(OW_CYCLES(OW_RESET_DELAY) / OW_CAL_LOOP_CYCLES))
+
+/**
+ * @def OW_CAL_SAMPLE_MAX
+ *
+ * Latest read sample point in us. Devices release a zero bit
+ * 15 us after the slot starts at the earliest.
+ */
+#define OW_CAL_SAMPLE_MAX		13
+
+#ifndef OW_MULTI_BUS
+OwTiming ow_timing;
+#endif
+
+/**
+ * @fn static uint16_t OwCount(uint16_t cycles)
+ * @brief Converts cycles to _delay_loop_2() count.
+ *
+ * @param cycles	delay in cycles
+ *
+ * @return count of at least one, zero would wait 65536 iterations
+ */
+static uint16_t OwCount(uint16_t cycles) {
+
+	return cycles < 8 ? 1 : cycles >> 2;
+
+}
+
+/**
+ * @fn static void OwTimingSet(uint16_t sample, uint16_t recovery, uint16_t presence)
+ * @brief Derives the slot delays of the selected bus.
+ *
+ * @param sample	release to read sample in cycles
+ * @param recovery	recovery after a slot in cycles
+ * @param presence	release of reset to presence sample in cycles
+ */
+static void OwTimingSet(uint16_t sample, uint16_t recovery, uint16_t presence) {
+
+	OwTiming* t = &OW_TIMING;
+
+	t->sample = OwCount(sample);
+	// read slot ends where a write slot ends
+	t->read_tail = OwCount(OW_CYCLES(OW_LONG_DELAY - OW_SHORT_DELAY) - sample + recovery);
+	t->zero_tail = OwCount(recovery);
+	t->one_tail = OwCount(OW_CYCLES(OW_LONG_DELAY - OW_SHORT_DELAY) + recovery);
+	t->presence = OwCount(presence);
+	t->reset_tail = OwCount(OW_CYCLES(OW_RESET_DELAY) - presence);
+
+}
+
+/**
+ * @fn void OwTimingDefaults(void)
+ * @brief Sets the timing of the selected bus to the fixed delays. Called by OwInit().
+ */
+void OwTimingDefaults(void) {
+
+	OwTimingSet(OW_CYCLES(OW_SAMPLE_DELAY), OW_CYCLES(OW_SHORT_DELAY), OW_CYCLES(OW_LONG_DELAY));
+	OW_TIMING.rise = 0;
+
+}
+
+/**
+ * @fn uint8_t OwCalibrate(void)
+ * @brief Measures the selected bus and stores its timing. A reset pulse is written and the time until the released bus rises, the start of the presence pulse and its end are counted. Read sample is moved 1 us past the rise time, recovery is twice the rise time and presence is sampled in the middle of the measured window, none of them below the fixed delays. Timing is left unchanged if the bus stays low or no presence pulse is seen.
+ *
+ * @return		0x01 if the bus was calibrated, otherwise 0x00.
+ */
+uint8_t OwCalibrate(void) {
+
+	uint16_t rise = 0;
+	uint16_t start = 0;
+	uint16_t width = 0;
+
+	uint32_t c_rise, c_start, c_end;
+	uint16_t sample, recovery, presence;
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		cli();
+	#endif
+
+	OwWriteBusLow();
+	OwDelay(OW_RESET_DELAY, OW_BUS_CYCLES);
+
+	// measuring loops are timed, same as the presence sample of a reset
+	#if defined(OW_BLOCK_INTERRUPTS_BITLEVEL) || defined(OW_BLOCK_INTERRUPTS_SAMPLE)
+		cli();
+	#endif
+
+	OwWriteBusHigh();
+
+	// released bus rising through the threshold
+	while(!OwSampleBus() && ++rise != OW_CAL_LIMIT);
+
+	// devices waiting before the presence pulse
+	while(OwSampleBus() && ++start != OW_CAL_LIMIT);
+
+	// presence pulse
+	while(!OwSampleBus() && ++width != OW_CAL_LIMIT);
+
+	#if defined(OW_BLOCK_INTERRUPTS_BITLEVEL) || defined(OW_BLOCK_INTERRUPTS_SAMPLE)
+		sei();
+	#endif
+
+	c_rise = (uint32_t)rise * OW_CAL_LOOP_CYCLES;
+	c_start = c_rise + (uint32_t)start * OW_CAL_LOOP_CYCLES;
+	c_end = c_start + (uint32_t)width * OW_CAL_LOOP_CYCLES;
+
+	// rest of the reset slot after the presence pulse
+	if(c_end < OW_CYCLES(OW_RESET_DELAY)) {
+		OwDelayCount(OwCount(OW_CYCLES(OW_RESET_DELAY) - c_end));
+	}
+
+	#ifdef OW_BLOCK_INTERRUPTS
+		sei();
+	#endif
+
+	// shorted bus, no devices or a window longer than a reset pulse
+	if(rise == OW_CAL_LIMIT || start == OW_CAL_LIMIT || width == OW_CAL_LIMIT || !width) {
+		return 0;
+	}
+
+	sample = c_rise + OW_CYCLES(1);
+
+	if(sample < OW_CYCLES(OW_SAMPLE_DELAY)) {
+		sample = OW_CYCLES(OW_SAMPLE_DELAY);
+	} else if(sample > OW_CYCLES(OW_CAL_SAMPLE_MAX)) {
+		sample = OW_CYCLES(OW_CAL_SAMPLE_MAX);
+	}
+
+	recovery = c_rise * 2;
+
+	if(recovery < OW_CYCLES(OW_SHORT_DELAY)) {
+		recovery = OW_CYCLES(OW_SHORT_DELAY);
+	}
+
+	presence = (c_start + c_end) >> 1;
+
+	if(presence > OW_CYCLES(OW_RESET_DELAY)) {
+		return 0;
+	}
+
+	OwTimingSet(sample, recovery, presence);
+	OW_TIMING.rise = c_rise / (F_CPU / 1000000UL);
+
+	return 1;
+
+}
+
+#endif
@@ -0,0 +1,113 @@
+/**
+ * @file onewire_uart.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * USART backend for the interrupt-driven engine. The USART is used as
+ * bus master: reset pulse is the character 0xF0 at 9600 baud and every
+ * bit slot is one character at 115200 baud. 0xFF writes a one or reads
+ * a bit, 0x00 writes a zero. The echo received from the bus carries the
+ * presence pulse or the bit read. Each character completes in the RX
+ * complete interrupt, so the application keeps running during transfers.
+ */
+
+#include "onewire_bus.h"
+
+#ifdef OW_UART
+
+/**
+ * @def OW_UART_UBRR_VALUE
+ *
+ * Baud rate register value in double speed mode.
+ */
+#define OW_UART_UBRR_VALUE(baud)	((F_CPU + 4UL * (baud)) / (8UL * (baud)) - 1)
+
+#define OW_UART_RESET_UBRR		OW_UART_UBRR_VALUE(9600)
+#define OW_UART_DATA_UBRR		OW_UART_UBRR_VALUE(115200)
+
+/**
+ * @fn static inline void OwUartSend(void)
+ * @brief Writes the character for the next reset or bit slot of the loaded operation.
+ */
+static inline void OwUartSend(void) {
+
+	if(ow_async.op == OW_OP_RESET) {
+
+		OW_UART_UBRR = OW_UART_RESET_UBRR;
+		OW_UART_UDR = 0xF0;
+
+	} else if(ow_async.op == OW_OP_READ || (ow_async.data & ow_async.mask)) {
+
+		OW_UART_UDR = 0xFF;
+
+	} else {
+
+		OW_UART_UDR = 0x00;
+
+	}
+
+}
+
+/**
+ * @fn void OwBackendInit(void)
+ * @brief Initializes the USART in double speed 8N1 mode with RX complete interrupt.
+ */
+void OwBackendInit(void) {
+
+	OW_UART_UBRR = OW_UART_DATA_UBRR;
+	OW_UART_UCSRA = 1 << U2X0;
+	OW_UART_UCSRC = (1 << UCSZ01) | (1 << UCSZ00);
+	OW_UART_UCSRB = (1 << RXCIE0) | (1 << RXEN0) | (1 << TXEN0);
+
+}
+
+/**
+ * @fn void OwBackendKick(void)
+ * @brief Starts a loaded operation.
+ */
+void OwBackendKick(void) {
+
+	OwUartSend();
+
+}
+
+/**
+ * @fn void OwBackendStop(void)
+ * @brief Nothing to stop, the USART is idle once the last echo is received.
+ */
+void OwBackendStop(void) {
+
+}
+
+ISR(OW_UART_RX_vect) {
+
+	uint8_t echo = OW_UART_UDR;
+	uint8_t finished;
+
+	if(ow_async.op == OW_OP_RESET) {
+
+		// presence pulse shortens the echoed low period
+		ow_async.result = echo != 0xF0;
+		OW_UART_UBRR = OW_UART_DATA_UBRR;
+		finished = 1;
+
+	} else {
+
+		// a device writing zero pulls the echo low
+		if(ow_async.op == OW_OP_READ && echo == 0xFF) {
+			ow_async.data |= ow_async.mask;
+		}
+
+		finished = !OwAsyncNextBit();
+
+	}
+
+	if(!finished || OwAsyncOpDone()) {
+		OwUartSend();
+	}
+
+}
+
+#endif
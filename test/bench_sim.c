@@ -0,0 +1,172 @@
+/**
+ * @file bench_sim.c
+ *
+ * @author Vilppu Vuorinen
+ *
+ * (c) 2013-2015, Vilppu Vuorinen
+ *
+ * Benchmark of the protocol layer on the simulated bus. Reports the
+ * resets, slots and bus time of each operation and fails when an
+ * operation gives a wrong result, so changes to the search and the
+ * transactions can be measured and checked without hardware.
+ *
+ * gcc -std=gnu99 -Wall -Isrc -DOW_SIM -DOW_CONTEXT_BUFFER test/bench_sim.c src/onewire*.c -o bench_sim
+ */
+
+#include <stdio.h>
+#include "onewire.h"
+#include "onewire_sim.h"
+
+#ifndef OW_CONTEXT_BUFFER
+	#error "bench_sim needs OW_CONTEXT_BUFFER for contexts of OW_SIM_DEVICES roms"
+#endif
+
+/**
+ * @def BENCH_MAX_DEVICES
+ *
+ * Largest bus of the search and sweep benchmarks.
+ */
+#define BENCH_MAX_DEVICES		64
+
+static uint8_t bench_buffer[OW_CONTEXT_BUFFER_SIZE(BENCH_MAX_DEVICES)];
+static OwContext bench_ctx;
+static uint8_t bench_failed;
+
+/**
+ * @fn static void BenchBus(uint8_t devices)
+ * @brief Builds a bus of DS18B20 sensors with pseudo-random serials and searches their roms.
+ *
+ * @param devices	number of sensors
+ */
+static void BenchBus(uint8_t devices) {
+
+	uint8_t i;
+	uint64_t serial = 0x2545F4914F6CDD1DULL;
+
+	OwSimInit();
+
+	for(i = 0; i < devices; i++) {
+
+		// xorshift spreads the serials over the whole search tree
+		serial ^= serial << 13;
+		serial ^= serial >> 7;
+		serial ^= serial << 17;
+
+		OwSimAdd(OW_SIM_DS18B20, serial & 0xFFFFFFFFFFFFULL);
+
+	}
+
+	OwInit();
+	OwContextInit(&bench_ctx, bench_buffer, BENCH_MAX_DEVICES);
+
+}
+
+/**
+ * @fn static void BenchReport(const char* name, uint8_t devices, uint8_t ok)
+ * @brief Prints the counters of the simulated bus since OwSimClear().
+ *
+ * @param name		operation
+ * @param devices	number of devices on the bus
+ * @param ok		0x00 if the operation gave a wrong result
+ */
+static void BenchReport(const char* name, uint8_t devices, uint8_t ok) {
+
+	OwSimCounters counters;
+
+	OwSimRead(&counters);
+
+	printf("%-24s %3u %8lu %8lu %10.0f  %s\n", name, devices, (unsigned long)counters.resets, (unsigned long)counters.slots, counters.time, ok ? "ok" : "FAIL");
+
+	if(!ok) {
+		bench_failed = 1;
+	}
+
+}
+
+/**
+ * @fn static void BenchSearch(uint8_t devices)
+ * @brief Searches the roms of a bus.
+ *
+ * @param devices	number of devices on the bus
+ */
+static void BenchSearch(uint8_t devices) {
+
+	uint8_t found;
+
+	BenchBus(devices);
+
+	OwSimClear();
+	found = OwSearchRom(&bench_ctx);
+	BenchReport("search", devices, found == devices);
+
+}
+
+/**
+ * @fn static void BenchSweep(uint8_t devices, uint8_t len, uint8_t verify)
+ * @brief Reads the scratchpad of every sensor of a bus with Match rom.
+ *
+ * @param devices	number of devices on the bus
+ * @param len		bytes read from each scratchpad
+ * @param verify	0x01 to read the whole scratchpad and check its crc
+ */
+static void BenchSweep(uint8_t devices, uint8_t len, uint8_t verify) {
+
+	uint8_t i;
+	uint8_t ok;
+	uint8_t buf[OW_SCRATCHPAD_SIZE];
+
+	BenchBus(devices);
+	ok = OwSearchRom(&bench_ctx) == devices;
+
+	OwSimClear();
+
+	for(i = 0; i < bench_ctx.count; i++) {
+		ok = OwReadScratchpad(&bench_ctx, i, buf, len, verify) && ok;
+	}
+
+	BenchReport(verify ? "sweep 9 bytes verified" : "sweep 2 bytes", devices, ok);
+
+}
+
+/**
+ * @fn static void BenchSelect(void)
+ * @brief Reads the temperature of a single sensor addressed with Match rom and with Skip rom.
+ */
+static void BenchSelect(void) {
+
+	uint8_t buf[2];
+	uint8_t ok;
+
+	BenchBus(1);
+	OwSearchRom(&bench_ctx);
+
+	OwSimClear();
+	ok = OwReadScratchpad(&bench_ctx, 0, buf, 2, 0);
+	BenchReport("read 2 bytes match rom", 1, ok);
+
+	OwSimClear();
+	ok = OwReadScratchpad(&bench_ctx, OW_TXN_SKIP_ROM, buf, 2, 0);
+	BenchReport("read 2 bytes skip rom", 1, ok);
+
+}
+
+int main(void) {
+
+	uint8_t devices;
+
+	printf("%-24s %3s %8s %8s %10s\n", "operation", "n", "resets", "slots", "bus us");
+
+	for(devices = 1; devices <= BENCH_MAX_DEVICES; devices <<= 1) {
+		BenchSearch(devices);
+	}
+
+	for(devices = 1; devices <= BENCH_MAX_DEVICES; devices <<= 1) {
+		BenchSweep(devices, 2, 0);
+		BenchSweep(devices, OW_SCRATCHPAD_SIZE, 1);
+	}
+
+	BenchSelect();
+
+	return bench_failed;
+
+}